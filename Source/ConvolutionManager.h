@@ -0,0 +1,255 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+#include "DspCommon.h"
+#include "Fft.h"
+
+// Uniformly partitioned overlap-save convolution of a mono input with a
+// stereo impulse response. The cost per sample depends only on the IR
+// length, not on what the IR contains. Output comes one partition late;
+// see getLatencySamples().
+//
+// loadImpulseResponse() may run on another thread: it publishes complete
+// partition spectra through a TripleBuffer, and the audio thread
+// crossfades from the old response to the new one over one partition.
+template <typename SampleType>
+class ConvolutionManager
+{
+public:
+    using Complex = std::complex<SampleType>;
+
+    // partitionSize must be a power of two
+    void prepare(int newPartitionSize, int maximumImpulseLength)
+    {
+        partitionSize = newPartitionSize;
+        fftSize = partitionSize * 2;
+        numBins = partitionSize + 1;
+        numPartitions = std::max(1, (maximumImpulseLength + partitionSize - 1) / partitionSize);
+
+        int order = 0;
+        while ((1 << order) < fftSize)
+            ++order;
+
+        fft.prepare(order);
+        loaderFft.prepare(order);
+
+        auto spectrumSize = static_cast<size_t>(numPartitions * numBins);
+
+        ImpulseSpectra empty;
+        for (auto* part : { &empty.leftReal, &empty.leftImag, &empty.rightReal, &empty.rightImag })
+            part->assign(spectrumSize, SampleType(0));
+        impulseSpectra.resetAll(empty);
+
+        inputReal.assign(spectrumSize, SampleType(0));
+        inputImag.assign(spectrumSize, SampleType(0));
+
+        inputFrame.assign(static_cast<size_t>(fftSize), SampleType(0));
+        workspace.assign(static_cast<size_t>(fftSize), Complex());
+        loaderWorkspace.assign(static_cast<size_t>(fftSize), Complex());
+
+        for (auto* buffer : { &outputLeft, &outputRight, &fadeLeft, &fadeRight })
+            buffer->assign(static_cast<size_t>(partitionSize), SampleType(0));
+
+        for (auto* buffer : { &accumulatorLeft, &accumulatorRight })
+            buffer->assign(static_cast<size_t>(numBins), Complex());
+
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill(inputReal.begin(), inputReal.end(), SampleType(0));
+        std::fill(inputImag.begin(), inputImag.end(), SampleType(0));
+        std::fill(inputFrame.begin(), inputFrame.end(), SampleType(0));
+        std::fill(outputLeft.begin(), outputLeft.end(), SampleType(0));
+        std::fill(outputRight.begin(), outputRight.end(), SampleType(0));
+        fifoPos = 0;
+        newestPartition = 0;
+    }
+
+    int getLatencySamples() const { return partitionSize; }
+    int getMaximumImpulseLength() const { return numPartitions * partitionSize; }
+
+    // Writer side: transforms the response into partition spectra and publishes them
+    void loadImpulseResponse(const SampleType* left, const SampleType* right, int length)
+    {
+        length = std::min(length, getMaximumImpulseLength());
+        auto& spectra = impulseSpectra.getWriteBuffer();
+
+        for (int partition = 0; partition < numPartitions; ++partition)
+        {
+            int start = partition * partitionSize;
+
+            // Left and right share one transform as real and imaginary parts
+            for (int i = 0; i < fftSize; ++i)
+            {
+                int index = start + i;
+                bool inside = i < partitionSize && index < length;
+                loaderWorkspace[static_cast<size_t>(i)] = inside ? Complex(left[index], right[index]) : Complex();
+            }
+
+            loaderFft.perform(loaderWorkspace.data(), false);
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                Complex z = loaderWorkspace[static_cast<size_t>(k)];
+                Complex mirror = std::conj(loaderWorkspace[static_cast<size_t>((fftSize - k) & (fftSize - 1))]);
+                Complex l = (z + mirror) * SampleType(0.5);
+                Complex r = (z - mirror) * Complex(0, SampleType(-0.5));
+
+                auto bin = static_cast<size_t>(partition * numBins + k);
+                spectra.leftReal[bin] = l.real();
+                spectra.leftImag[bin] = l.imag();
+                spectra.rightReal[bin] = r.real();
+                spectra.rightImag[bin] = r.imag();
+            }
+        }
+
+        impulseSpectra.publish();
+    }
+
+    // Audio side: convolves the mono input into the two output blocks
+    void processBlock(const SampleType* input, SampleType* left, SampleType* right, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            inputFrame[static_cast<size_t>(partitionSize + fifoPos)] = input[i];
+            left[i] = outputLeft[static_cast<size_t>(fifoPos)];
+            right[i] = outputRight[static_cast<size_t>(fifoPos)];
+
+            if (++fifoPos == partitionSize)
+            {
+                fifoPos = 0;
+                processPartition();
+            }
+        }
+    }
+
+private:
+    // Split real and imaginary parts so the multiply-adds vectorise
+    struct ImpulseSpectra
+    {
+        std::vector<SampleType> leftReal, leftImag, rightReal, rightImag;
+    };
+
+    void processPartition()
+    {
+        // Overlap-save: transform the last two partitions of input
+        for (int i = 0; i < fftSize; ++i)
+            workspace[static_cast<size_t>(i)] = Complex(inputFrame[static_cast<size_t>(i)], SampleType(0));
+
+        fft.perform(workspace.data(), false);
+
+        newestPartition = (newestPartition + 1) % numPartitions;
+        auto offset = static_cast<size_t>(newestPartition * numBins);
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            inputReal[offset + static_cast<size_t>(k)] = workspace[static_cast<size_t>(k)].real();
+            inputImag[offset + static_cast<size_t>(k)] = workspace[static_cast<size_t>(k)].imag();
+        }
+
+        std::copy(inputFrame.begin() + partitionSize, inputFrame.end(), inputFrame.begin());
+
+        if (impulseSpectra.hasUpdate())
+        {
+            // The old spectra stay ours until update() hands them back
+            convolve(impulseSpectra.getReadBuffer(), fadeLeft.data(), fadeRight.data());
+            impulseSpectra.update();
+            convolve(impulseSpectra.getReadBuffer(), outputLeft.data(), outputRight.data());
+
+            for (int i = 0; i < partitionSize; ++i)
+            {
+                SampleType gain = static_cast<SampleType>(i) / static_cast<SampleType>(partitionSize);
+                outputLeft[static_cast<size_t>(i)] = fadeLeft[static_cast<size_t>(i)] + gain * (outputLeft[static_cast<size_t>(i)] - fadeLeft[static_cast<size_t>(i)]);
+                outputRight[static_cast<size_t>(i)] = fadeRight[static_cast<size_t>(i)] + gain * (outputRight[static_cast<size_t>(i)] - fadeRight[static_cast<size_t>(i)]);
+            }
+        }
+        else
+        {
+            convolve(impulseSpectra.getReadBuffer(), outputLeft.data(), outputRight.data());
+        }
+    }
+
+    void convolve(const ImpulseSpectra& spectra, SampleType* destLeft, SampleType* destRight)
+    {
+        std::fill(accumulatorLeft.begin(), accumulatorLeft.end(), Complex());
+        std::fill(accumulatorRight.begin(), accumulatorRight.end(), Complex());
+
+        SampleType* leftAccumulator = reinterpret_cast<SampleType*>(accumulatorLeft.data());
+        SampleType* rightAccumulator = reinterpret_cast<SampleType*>(accumulatorRight.data());
+
+        // Partition j of the response meets the input from j partitions ago
+        for (int partition = 0; partition < numPartitions; ++partition)
+        {
+            int inputPartition = newestPartition - partition;
+            if (inputPartition < 0)
+                inputPartition += numPartitions;
+
+            const SampleType* xr = inputReal.data() + inputPartition * numBins;
+            const SampleType* xi = inputImag.data() + inputPartition * numBins;
+            const SampleType* lr = spectra.leftReal.data() + partition * numBins;
+            const SampleType* li = spectra.leftImag.data() + partition * numBins;
+            const SampleType* rr = spectra.rightReal.data() + partition * numBins;
+            const SampleType* ri = spectra.rightImag.data() + partition * numBins;
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                leftAccumulator[2 * k] += xr[k] * lr[k] - xi[k] * li[k];
+                leftAccumulator[2 * k + 1] += xr[k] * li[k] + xi[k] * lr[k];
+                rightAccumulator[2 * k] += xr[k] * rr[k] - xi[k] * ri[k];
+                rightAccumulator[2 * k + 1] += xr[k] * ri[k] + xi[k] * rr[k];
+            }
+        }
+
+        // Both outputs are real, so they share one inverse transform
+        for (int k = 0; k < numBins; ++k)
+        {
+            Complex l = accumulatorLeft[static_cast<size_t>(k)];
+            Complex r = accumulatorRight[static_cast<size_t>(k)];
+
+            workspace[static_cast<size_t>(k)] = l + Complex(0, 1) * r;
+
+            if (k > 0 && k < numBins - 1)
+                workspace[static_cast<size_t>(fftSize - k)] = std::conj(l) + Complex(0, 1) * std::conj(r);
+        }
+
+        fft.perform(workspace.data(), true);
+
+        // The second half is free of circular wrap-around
+        SampleType scale = SampleType(1) / static_cast<SampleType>(fftSize);
+        for (int i = 0; i < partitionSize; ++i)
+        {
+            Complex value = workspace[static_cast<size_t>(partitionSize + i)];
+            destLeft[i] = value.real() * scale;
+            destRight[i] = value.imag() * scale;
+        }
+    }
+
+    int partitionSize = 512;
+    int fftSize = 1024;
+    int numBins = 513;
+    int numPartitions = 1;
+    int fifoPos = 0;
+    int newestPartition = 0;
+
+    Fft<SampleType> fft;
+    Fft<SampleType> loaderFft;
+
+    TripleBuffer<ImpulseSpectra> impulseSpectra;
+
+    // Frequency-domain delay line of past input partitions
+    std::vector<SampleType> inputReal;
+    std::vector<SampleType> inputImag;
+
+    std::vector<SampleType> inputFrame;
+    std::vector<Complex> workspace;
+    std::vector<Complex> loaderWorkspace;
+    std::vector<Complex> accumulatorLeft;
+    std::vector<Complex> accumulatorRight;
+    std::vector<SampleType> outputLeft;
+    std::vector<SampleType> outputRight;
+    std::vector<SampleType> fadeLeft;
+    std::vector<SampleType> fadeRight;
+};
@@ -1,78 +1,724 @@
 #pragma once
 
-#include <JuceHeader.h>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <random>
+#include "DspCommon.h"
+#include "DspKernels.h"
 #include "StereoFieldManager.h"
+#include "FdnManager.h"
+#include "ConvolutionManager.h"
 
+template <typename SampleType>
 class DampManager
 {
 public:
-    DampManager();
+    enum class DampMode
+    {
+        TapCloud,   // Hand-placed echoes and early reflections
+        Fdn8,       // 8-line feedback delay network
+        Fdn16,      // 16-line feedback delay network
+        Convolution // Tap pattern plus a diffuse tail, rendered to an impulse response
+    };
 
-    void prepare(const juce::dsp::ProcessSpec& spec);
-    void reset();
-    void setDamp(float newDamp);
-    void process(float& sampleLeft, float& sampleRight);
+    DampManager()
+    {
+        // Seed RNG with a unique value
+        std::random_device rd;
+        rng.seed(rd());
+    }
 
-private:
-    void precalculateValues();
-    void generateReflectionPattern();
-    void updateEchoParameters();
+    ~DampManager()
+    {
+        stopWorker();
+    }
+
+    void prepare(const EngineSpec& spec)
+    {
+        // The worker shares the tap pattern state, so keep it out while that is rebuilt
+        stopWorker();
+
+        sampleRate = static_cast<SampleType>(spec.sampleRate);
+        reset();
+
+        // A whole block is written before it is read, so leave a block of headroom
+        echoBufferSize = static_cast<int>(MAX_ECHO_TIME * sampleRate) + 1 + DspKernels::MAX_BLOCK_SIZE;
+        echoBuffer.assign(static_cast<size_t>(echoBufferSize), SampleType(0));
+
+        // Prepare stereo managers before the first tap set needs their panning tables
+        int totalDelays = MAX_ECHOES + MAX_REFLECTIONS;
+        for (int i = 0; i < totalDelays; ++i) {
+            stereoManagers[i].prepare(spec);
+        }
+
+        // Precompute the modulation table
+        for (int i = 0; i < MODULATION_TABLE_SIZE; ++i)
+        {
+            SampleType phase = EngineConstants<SampleType>::twoPi * static_cast<SampleType>(i) / MODULATION_TABLE_SIZE;
+            modulationTable[i] = SampleType(1) + modulationDepth * std::sin(phase);
+        }
+
+        // The first tap set is built here and taken over straight away
+        generateReflectionPattern();
+        updateEchoParameters(smoothedDamp);
+        publishTapSet();
+        tapSets.update();
+        previousTaps = tapSets.getReadBuffer();
+        tapCrossfadeGain = 1;
+        tapCrossfadeIncrement = SampleType(1) / (TAP_CROSSFADE_TIME * sampleRate);
+        requestedDamp.store(smoothedDamp);
+        lastRequestedDamp = smoothedDamp;
+
+        // Set the initial cutoff frequency higher if needed
+        initialCutoff = SampleType(10000); // Increase cutoff to 10kHz
+        lowpassFilterLeft.setLowPass(spec.sampleRate, initialCutoff);
+        lowpassFilterRight.setLowPass(spec.sampleRate, initialCutoff);
+
+        fdn.prepare(spec);
+        fdn.setDecayTime(decayTime);
+        fdn.setDampingFrequency(initialCutoff);
+
+        // The pre-delay leaves the start of the response silent, so a partition
+        // of convolution latency can be taken out of the response itself
+        int preDelaySamples = static_cast<int>((PRE_DELAY_MS / SampleType(1000)) * sampleRate);
+        int partitionSize = MIN_PARTITION_SIZE;
+        while (partitionSize * 2 <= std::min(preDelaySamples, MAX_PARTITION_SIZE))
+            partitionSize *= 2;
+
+        convolution.prepare(partitionSize, static_cast<int>(IMPULSE_LENGTH * sampleRate));
+        impulseLeft.assign(static_cast<size_t>(convolution.getMaximumImpulseLength()), SampleType(0));
+        impulseRight.assign(static_cast<size_t>(convolution.getMaximumImpulseLength()), SampleType(0));
+        renderImpulseResponse();
+
+        // Calculate integer modulation rate for efficient computation
+        modulationRateInt = static_cast<int>(modulationRate * MODULATION_TABLE_SIZE / sampleRate);
+
+        startWorker();
+    }
+
+    void reset()
+    {
+        std::fill(echoBuffer.begin(), echoBuffer.end(), SampleType(0));
+        writePos = 0;
+        smoothedDamp = damp;
+        smoothedDamping.reset(sampleRate, 0.1);
+        modulationPhase = 0;
+        lowpassFilterLeft.reset();
+        lowpassFilterRight.reset();
+        convolution.reset();
+        fdn.reset();
+    }
+
+    // How long the given mode keeps sounding after its input stops: the
+    // latest possible tap, the rendered response, or the network's decay time
+    SampleType getTailSeconds(DampMode forMode) const
+    {
+        if (forMode == DampMode::TapCloud)
+            return MAX_ECHO_TIME;
+
+        if (forMode == DampMode::Convolution)
+            return IMPULSE_LENGTH;
 
+        return decayTime;
+    }
+
+    void setMode(DampMode newMode)
+    {
+        if (mode == newMode)
+            return;
+
+        // Start the network empty rather than from an old tail
+        if (newMode == DampMode::Fdn8 || newMode == DampMode::Fdn16)
+        {
+            fdn.setNumLines(newMode == DampMode::Fdn16 ? 16 : 8);
+            fdn.reset();
+        }
+
+        if (newMode == DampMode::Convolution)
+            convolution.reset();
+
+        // The worker only renders impulse responses while they are heard
+        impulseWanted.store(newMode == DampMode::Convolution);
+        mode = newMode;
+
+        if (newMode == DampMode::Convolution)
+            workPending.store(true, std::memory_order_release);
+    }
+
+    void setDamp(SampleType newDamp)
+    {
+        damp = std::clamp(newDamp, SampleType(0), SampleType(1));
+        smoothedDamping.setTargetValue(damp);
+    }
+
+    // Processes the wet bus in place; numSamples may not exceed DspKernels::MAX_BLOCK_SIZE
+    void processBlock(SampleType* left, SampleType* right, int numSamples)
+    {
+        SampleType firstDamp = smoothedDamping.getCurrentValue();
+
+        for (int i = 0; i < numSamples; ++i)
+            dampGains[i] = smoothedDamping.getNextValue();
+
+        smoothedDamp = dampGains[numSamples - 1];
+
+        // The ramp is linear, so its two ends tell whether any of it is audible
+        if (std::max(firstDamp, smoothedDamp) < SampleType(0.01)) {
+            writePos = (writePos + numSamples) % echoBufferSize;
+            return;
+        }
+
+        if (mode == DampMode::TapCloud)
+        {
+            processTaps(left, right, numSamples);
+        }
+        else if (mode == DampMode::Convolution)
+        {
+            processConvolution(left, right, numSamples);
+        }
+        else
+        {
+            for (int i = 0; i < numSamples; ++i)
+                fdn.processSample(left[i], right[i], outputLeft[i], outputRight[i]);
+        }
+
+        // Mix the processed signal with the dry signal
+        for (int i = 0; i < numSamples; ++i)
+        {
+            left[i] += dampGains[i] * (outputLeft[i] - left[i]);
+            right[i] += dampGains[i] * (outputRight[i] - right[i]);
+        }
+
+        // Only flag the change; the worker builds the new tap set
+        if (std::abs(smoothedDamp - lastRequestedDamp) > SampleType(0.01))
+        {
+            requestedDamp.store(smoothedDamp, std::memory_order_relaxed);
+            lastRequestedDamp = smoothedDamp;
+            workPending.store(true, std::memory_order_release);
+        }
+    }
+
+private:
     // Constants
-    static constexpr int MAX_ECHOES = 10;        // Maximum number of echoes
-    static constexpr int MAX_REFLECTIONS = 5;    // Maximum number of reflections
-    static constexpr float MAX_ECHO_TIME = 1.0f; // Maximum echo time in seconds
-    static constexpr float PRE_DELAY_MS = 20.0f; // Pre-delay in milliseconds
+    static constexpr int MAX_ECHOES = 10;                          // Maximum number of echoes
+    static constexpr int MAX_REFLECTIONS = 5;                      // Maximum number of reflections
+    static constexpr SampleType MAX_ECHO_TIME = SampleType(1);     // Maximum echo time in seconds
+    static constexpr SampleType PRE_DELAY_MS = SampleType(20);     // Pre-delay in milliseconds
     static constexpr int MODULATION_TABLE_SIZE = 1024;
+    static constexpr SampleType TAP_CROSSFADE_TIME = SampleType(0.02); // Seconds to fade between tap sets
+    static constexpr SampleType IMPULSE_LENGTH = SampleType(0.5);  // Covers the latest echo tap
+    static constexpr int DIFFUSE_TAPS = 1024;                      // Extra taps in a rendered response
+    static constexpr int MIN_PARTITION_SIZE = 64;
+    static constexpr int MAX_PARTITION_SIZE = 1024;
+    static constexpr int WORKER_CHECK_MS = 10;                     // Longest wait before the worker sees a request
+
+    // Everything the audio thread needs from one tap pattern, with the
+    // echo level and panning folded into the gains
+    struct TapSet
+    {
+        int numEchoes = 0;
+        std::array<int, MAX_ECHOES> echoDelays {};
+        std::array<SampleType, MAX_ECHOES> echoGainsLeft {};
+        std::array<SampleType, MAX_ECHOES> echoGainsRight {};
+
+        int numReflections = 0;
+        std::array<int, MAX_REFLECTIONS> reflectionDelays {};
+        std::array<SampleType, MAX_REFLECTIONS> reflectionGainsLeft {};
+        std::array<SampleType, MAX_REFLECTIONS> reflectionGainsRight {};
+    };
+
+    void processTaps(const SampleType* left, const SampleType* right, int numSamples)
+    {
+        // Take over a newer tap set from the worker, fading out of the old one.
+        // A set published mid-fade waits for the fade to finish, so the set
+        // still fading out never drops out in one step
+        if (tapCrossfadeGain >= SampleType(1) && tapSets.hasUpdate())
+        {
+            previousTaps = tapSets.getReadBuffer();
+            tapSets.update();
+            tapCrossfadeGain = 0;
+        }
+
+        // Every tap reads the mono sum, so only the sum is stored
+        int firstPart = std::min(numSamples, echoBufferSize - writePos);
+        for (int i = 0; i < firstPart; ++i)
+            echoBuffer[static_cast<size_t>(writePos + i)] = left[i] + right[i];
+        for (int i = firstPart; i < numSamples; ++i)
+            echoBuffer[static_cast<size_t>(i - firstPart)] = left[i] + right[i];
+
+        accumulateTaps(tapSets.getReadBuffer(), outputLeft.data(), outputRight.data(), numSamples);
+
+        if (tapCrossfadeGain < SampleType(1))
+        {
+            accumulateTaps(previousTaps, previousLeft.data(), previousRight.data(), numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                outputLeft[i] = previousLeft[i] + tapCrossfadeGain * (outputLeft[i] - previousLeft[i]);
+                outputRight[i] = previousRight[i] + tapCrossfadeGain * (outputRight[i] - previousRight[i]);
+
+                tapCrossfadeGain = std::min(tapCrossfadeGain + tapCrossfadeIncrement, SampleType(1));
+            }
+        }
+
+        applyModulationAndFilter(numSamples);
+    }
+
+    void processConvolution(const SampleType* left, const SampleType* right, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            monoInput[i] = left[i] + right[i];
+
+        convolution.processBlock(monoInput.data(), outputLeft.data(), outputRight.data(), numSamples);
+
+        applyModulationAndFilter(numSamples);
+    }
+
+    // The modulation scales every tap alike, so it is applied once to the sum
+    void applyModulationAndFilter(int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            SampleType modulationFactor = modulationTable[((writePos + i) * modulationRateInt) % MODULATION_TABLE_SIZE];
+
+            // Apply low-pass filter
+            outputLeft[i] = lowpassFilterLeft.processSample(outputLeft[i] * modulationFactor);
+            outputRight[i] = lowpassFilterRight.processSample(outputRight[i] * modulationFactor);
+        }
+
+        writePos = (writePos + numSamples) % echoBufferSize;
+    }
+
+    // Each tap adds one contiguous span of the echo buffer, split where it wraps
+    void accumulateTaps(const TapSet& taps, SampleType* destLeft, SampleType* destRight, int numSamples) const
+    {
+        std::fill(destLeft, destLeft + numSamples, SampleType(0));
+        std::fill(destRight, destRight + numSamples, SampleType(0));
+
+        for (int i = 0; i < taps.numEchoes; ++i)
+            accumulateTap(taps.echoDelays[i], taps.echoGainsLeft[i], taps.echoGainsRight[i], destLeft, destRight, numSamples);
+
+        for (int i = 0; i < taps.numReflections; ++i)
+            accumulateTap(taps.reflectionDelays[i], taps.reflectionGainsLeft[i], taps.reflectionGainsRight[i],
+                          destLeft, destRight, numSamples);
+    }
+
+    void accumulateTap(int delay, SampleType gainLeft, SampleType gainRight,
+                       SampleType* destLeft, SampleType* destRight, int numSamples) const
+    {
+        auto& kernels = DspKernels::get<SampleType>();
+
+        int readPos = writePos - delay;
+        if (readPos < 0)
+            readPos += echoBufferSize;
+
+        int firstPart = std::min(numSamples, echoBufferSize - readPos);
+        const SampleType* source = echoBuffer.data() + readPos;
+
+        kernels.addWithMultiply(destLeft, source, gainLeft, firstPart);
+        kernels.addWithMultiply(destRight, source, gainRight, firstPart);
+
+        if (firstPart < numSamples)
+        {
+            kernels.addWithMultiply(destLeft + firstPart, echoBuffer.data(), gainLeft, numSamples - firstPart);
+            kernels.addWithMultiply(destRight + firstPart, echoBuffer.data(), gainRight, numSamples - firstPart);
+        }
+    }
+
+    //==============================================================================
+    // Worker thread: everything below runs off the audio thread
+
+    void startWorker()
+    {
+        workerRunning.store(true);
+        worker = std::thread([this] { runWorker(); });
+    }
+
+    void stopWorker()
+    {
+        {
+            std::lock_guard<std::mutex> lock(workerMutex);
+            workerRunning.store(false);
+        }
+
+        workerCondition.notify_one();
+
+        if (worker.joinable())
+            worker.join();
+    }
+
+    // The audio thread only raises workPending and never touches the mutex
+    // or the condition variable, so it can't block on the worker. The worker
+    // checks the flag on a timed wait; only stopWorker() wakes it early
+    void runWorker()
+    {
+        SampleType builtDamp = requestedDamp.load();
+        bool impulseIsCurrent = true;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(workerMutex);
+                workerCondition.wait_for(lock, std::chrono::milliseconds(WORKER_CHECK_MS),
+                                         [this] { return ! workerRunning.load(); });
+
+                if (! workerRunning.load())
+                    return;
+            }
+
+            if (! workPending.exchange(false, std::memory_order_acquire))
+                continue;
+
+            SampleType newDamp = requestedDamp.load(std::memory_order_relaxed);
+
+            if (newDamp != builtDamp)
+            {
+                updateEchoParameters(newDamp);
+                publishTapSet();
+                builtDamp = newDamp;
+                impulseIsCurrent = false;
+            }
+
+            if (! impulseIsCurrent && impulseWanted.load(std::memory_order_relaxed))
+            {
+                renderImpulseResponse();
+                impulseIsCurrent = true;
+            }
+        }
+    }
+
+    void publishTapSet()
+    {
+        TapSet& taps = tapSets.getWriteBuffer();
+
+        // The echo taps are mixed to mono at 1.25x, the reflections at 0.5x
+        taps.numEchoes = numActiveEchoes;
+        for (int i = 0; i < numActiveEchoes; ++i)
+        {
+            taps.echoDelays[i] = echoDelays[i];
+            taps.echoGainsLeft[i] = decayGainsLeft[i] * SampleType(1.25);
+            taps.echoGainsRight[i] = decayGainsRight[i] * SampleType(1.25);
+        }
+
+        taps.numReflections = std::min(static_cast<int>(reflectionDelays.size()), MAX_REFLECTIONS);
+        for (int i = 0; i < taps.numReflections; ++i)
+        {
+            taps.reflectionDelays[i] = reflectionDelays[static_cast<size_t>(i)];
+            taps.reflectionGainsLeft[i] = reflectionDecayGainsLeft[static_cast<size_t>(i)] * SampleType(0.5);
+            taps.reflectionGainsRight[i] = reflectionDecayGainsRight[static_cast<size_t>(i)] * SampleType(0.5);
+        }
+
+        tapSets.publish();
+    }
+
+    // Renders the current taps, plus a decaying cloud of random ones that a
+    // tap loop could never afford, and hands the result to the convolution
+    void renderImpulseResponse()
+    {
+        std::fill(impulseLeft.begin(), impulseLeft.end(), SampleType(0));
+        std::fill(impulseRight.begin(), impulseRight.end(), SampleType(0));
+
+        int latency = convolution.getLatencySamples();
+        int length = static_cast<int>(impulseLeft.size());
+        SampleType tapEnergy = 0;
+
+        auto addTap = [&](int delay, SampleType gainLeft, SampleType gainRight)
+        {
+            int index = std::clamp(delay - latency, 0, length - 1);
+            impulseLeft[static_cast<size_t>(index)] += gainLeft;
+            impulseRight[static_cast<size_t>(index)] += gainRight;
+            tapEnergy += gainLeft * gainLeft + gainRight * gainRight;
+        };
+
+        // Same gains as the tap cloud
+        for (int i = 0; i < numActiveEchoes; ++i)
+            addTap(echoDelays[i], decayGainsLeft[i] * SampleType(1.25), decayGainsRight[i] * SampleType(1.25));
+
+        for (size_t i = 0; i < reflectionDelays.size(); ++i)
+            addTap(reflectionDelays[i], reflectionDecayGainsLeft[i] * SampleType(0.5),
+                   reflectionDecayGainsRight[i] * SampleType(0.5));
+
+        // Diffuse taps between the pre-delay and the end of the response
+        int preDelaySamples = static_cast<int>((PRE_DELAY_MS / SampleType(1000)) * sampleRate);
+        std::uniform_int_distribution<int> position(std::max(preDelaySamples, latency), length + latency - 1);
+        std::uniform_real_distribution<SampleType> unit(SampleType(0), SampleType(1));
+
+        SampleType diffuseEnergy = 0;
+        for (int i = 0; i < DIFFUSE_TAPS; ++i)
+        {
+            int delay = position(rng);
+            SampleType time = static_cast<SampleType>(delay) / sampleRate;
+            SampleType gain = std::exp(-time / decayTime) * (unit(rng) < SampleType(0.5) ? SampleType(-1) : SampleType(1));
+            SampleType pan = unit(rng) * EngineConstants<SampleType>::pi * SampleType(0.5);
+
+            diffuseDelays[i] = delay;
+            diffuseGainsLeft[i] = gain * std::cos(pan);
+            diffuseGainsRight[i] = gain * std::sin(pan);
+            diffuseEnergy += gain * gain;
+        }
+
+        // The cloud gets the energy of the discrete taps, and the sum is
+        // scaled back so the response sits at the level of the tap cloud
+        SampleType diffuseScale = diffuseEnergy > SampleType(0) ? std::sqrt(tapEnergy / diffuseEnergy) : SampleType(0);
+
+        for (int i = 0; i < DIFFUSE_TAPS; ++i)
+        {
+            auto index = static_cast<size_t>(diffuseDelays[i] - latency);
+            impulseLeft[index] += diffuseGainsLeft[i] * diffuseScale;
+            impulseRight[index] += diffuseGainsRight[i] * diffuseScale;
+        }
+
+        SampleType levelScale = std::sqrt(SampleType(0.5));
+        for (size_t i = 0; i < impulseLeft.size(); ++i)
+        {
+            impulseLeft[i] *= levelScale;
+            impulseRight[i] *= levelScale;
+        }
+
+        convolution.loadImpulseResponse(impulseLeft.data(), impulseRight.data(), length);
+    }
+
+    void precalculateValues()
+    {
+        SampleType cumulativeLeftGain = 0;
+        SampleType cumulativeRightGain = 0;
+
+        // Recalculate decay gains for echoes and compute cumulative gains
+        for (int i = 0; i < numActiveEchoes; ++i)
+        {
+            SampleType time = static_cast<SampleType>(echoDelays[i]) / sampleRate;
+            SampleType decayGain = echoGains[i] * std::exp(-time / decayTime);
+
+            // Get panning gains
+            SampleType leftGain = stereoManagers[i].getLeftGain();
+            SampleType rightGain = stereoManagers[i].getRightGain();
+
+            // Store individual left and right decay gains
+            decayGainsLeft[i] = decayGain * leftGain;
+            decayGainsRight[i] = decayGain * rightGain;
+
+            cumulativeLeftGain += decayGainsLeft[i];
+            cumulativeRightGain += decayGainsRight[i];
+        }
+
+        // Recalculate decay gains for reflections and compute cumulative gains
+        reflectionDecayGainsLeft.resize(reflectionDelays.size());
+        reflectionDecayGainsRight.resize(reflectionDelays.size());
+
+        for (size_t i = 0; i < reflectionDelays.size(); ++i)
+        {
+            SampleType time = static_cast<SampleType>(reflectionDelays[i]) / sampleRate;
+            SampleType decayGain = reflectionGains[i] * std::exp(SampleType(-2) * time / decayTime);
+
+            int index = numActiveEchoes + static_cast<int>(i);
+            SampleType leftGain = stereoManagers[index].getLeftGain();
+            SampleType rightGain = stereoManagers[index].getRightGain();
+
+            // Store individual left and right decay gains
+            reflectionDecayGainsLeft[i] = decayGain * leftGain;
+            reflectionDecayGainsRight[i] = decayGain * rightGain;
+
+            cumulativeLeftGain += reflectionDecayGainsLeft[i];
+            cumulativeRightGain += reflectionDecayGainsRight[i];
+        }
+
+        // Normalize left channel gains if necessary
+        if (cumulativeLeftGain > SampleType(0.99))
+        {
+            SampleType normalizationFactorLeft = SampleType(0.99) / cumulativeLeftGain;
+
+            for (int i = 0; i < numActiveEchoes; ++i)
+            {
+                decayGainsLeft[i] *= normalizationFactorLeft;
+            }
+
+            for (size_t i = 0; i < reflectionDecayGainsLeft.size(); ++i)
+            {
+                reflectionDecayGainsLeft[i] *= normalizationFactorLeft;
+            }
+        }
+
+        // Normalize right channel gains if necessary
+        if (cumulativeRightGain > SampleType(0.99))
+        {
+            SampleType normalizationFactorRight = SampleType(0.99) / cumulativeRightGain;
+
+            for (int i = 0; i < numActiveEchoes; ++i)
+            {
+                decayGainsRight[i] *= normalizationFactorRight;
+            }
+
+            for (size_t i = 0; i < reflectionDecayGainsRight.size(); ++i)
+            {
+                reflectionDecayGainsRight[i] *= normalizationFactorRight;
+            }
+        }
+    }
+
+    void generateReflectionPattern()
+    {
+        reflectionDelays.clear();
+        reflectionGains.clear();
+
+        int preDelaySamples = static_cast<int>((PRE_DELAY_MS / SampleType(1000)) * sampleRate);
+
+        int maxReflectionDelayMs = 100; // Maximum reflection delay in ms
+        int maxDelay = static_cast<int>((static_cast<SampleType>(maxReflectionDelayMs) / SampleType(1000)) * sampleRate); // Convert to samples
+
+        SampleType totalReflectionGain = 0;
+
+        for (int i = 0; i < MAX_REFLECTIONS; ++i)
+        {
+            int delay = preDelaySamples + static_cast<int>(maxDelay * (i + 1) / (MAX_REFLECTIONS + 1));
+
+            delay = std::min(delay, echoBufferSize - 1);
+
+            // Adjust the gain calculation to have higher initial values
+            SampleType gain = std::pow(SampleType(1.5), static_cast<SampleType>(i));
+            totalReflectionGain += gain;
+
+            reflectionDelays.push_back(delay);
+            reflectionGains.push_back(gain);
+        }
+
+        // Normalize reflection gains
+        if (totalReflectionGain > SampleType(0))
+        {
+            SampleType normalizationFactor = SampleType(1) / totalReflectionGain;
+            for (size_t i = 0; i < reflectionGains.size(); ++i)
+            {
+                reflectionGains[i] *= normalizationFactor;
+            }
+        }
+
+        reflectionDecayGainsLeft.resize(reflectionDelays.size(), SampleType(1));
+        reflectionDecayGainsRight.resize(reflectionDelays.size(), SampleType(1));
+
+        // Recalculate positions for reflections
+        numActiveReflections = static_cast<int>(reflectionDelays.size());
+        for (size_t j = 0; j < reflectionDelays.size(); ++j)
+        {
+            int i = MAX_ECHOES + static_cast<int>(j);
+            stereoManagers[i].calculateAndSetPosition(static_cast<int>(j), numActiveReflections);
+        }
+    }
+
+    void updateEchoParameters(SampleType dampValue)
+    {
+        numActiveEchoes = static_cast<int>(dampValue * MAX_ECHOES) + 1;
+        numActiveEchoes = std::clamp(numActiveEchoes, 2, MAX_ECHOES);
+
+        // Ensure even number of echoes for symmetry
+        if (numActiveEchoes % 2 != 0)
+            numActiveEchoes -= 1;
+
+        // Use the class member RNG
+        std::uniform_real_distribution<SampleType> delayJitter(SampleType(-0.02), SampleType(0.02)); // ±20ms jitter
+
+        for (int i = 0; i < numActiveEchoes; ++i)
+        {
+            // Assign equal base gain
+            echoGains[i] = SampleType(1) / static_cast<SampleType>(numActiveEchoes);
+
+            // Modify delayFactor with jitter
+            SampleType t = (static_cast<SampleType>(i) / static_cast<SampleType>(numActiveEchoes - 1));
+            SampleType delayFactor = SampleType(0.05) + SampleType(0.4) * t + delayJitter(rng);
+            delayFactor = std::clamp(delayFactor, SampleType(0), SampleType(1));
+
+            echoDelays[i] = static_cast<int>(delayFactor * MAX_ECHO_TIME * sampleRate);
+            echoDelays[i] = std::min(echoDelays[i], echoBufferSize - 1);
+
+            // Calculate and set stereo position for this echo
+            stereoManagers[i].calculateAndSetPosition(i, numActiveEchoes);
+        }
+
+        // Recalculate decay gains with the new echo gains
+        precalculateValues();
+    }
 
     // Member variables
-    float sampleRate;
-    float damp;
-    float smoothedDamp;
-    float lastUpdatedDamp;
-    juce::SmoothedValue<float> smoothedDamping;
+    SampleType sampleRate = SampleType(44100);
+    SampleType damp = 0;
+    SampleType smoothedDamp = 0;
+    LinearSmoothedValue<SampleType> smoothedDamping { SampleType(0.001) };
 
-    float roomSize;
-    float reflectionGain;
-    float decayTime;
-    float modulationRate;
-    int modulationRateInt;
-    float modulationDepth;
-    float modulationPhase;
+    SampleType roomSize = SampleType(1);
+    SampleType reflectionGain = SampleType(0.7);
+    SampleType decayTime = SampleType(1.5);
+    SampleType modulationRate = SampleType(0.5);
+    int modulationRateInt = 0;
+    SampleType modulationDepth = SampleType(0.1);
+    SampleType modulationPhase = 0;
 
-    float initialCutoff;
-    float cutoffDecayRate;
+    SampleType initialCutoff = SampleType(20000);
+    SampleType cutoffDecayRate = SampleType(0.5);
 
-    int writePos;
+    int writePos = 0;
 
-    std::array<float, MODULATION_TABLE_SIZE> modulationTable;
+    std::array<SampleType, MODULATION_TABLE_SIZE> modulationTable {};
 
-    // Echo parameters
-    std::array<int, MAX_ECHOES> echoDelays;
-    std::array<float, MAX_ECHOES> echoGains;
-    std::array<float, MAX_ECHOES> decayGainsLeft;
-    std::array<float, MAX_ECHOES> decayGainsRight;
+    // Echo parameters, owned by the worker once prepared
+    std::array<int, MAX_ECHOES> echoDelays {};
+    std::array<SampleType, MAX_ECHOES> echoGains {};
+    std::array<SampleType, MAX_ECHOES> decayGainsLeft {};
+    std::array<SampleType, MAX_ECHOES> decayGainsRight {};
 
     // Reflection parameters
     std::vector<int> reflectionDelays;
-    std::vector<float> reflectionGains;
-    std::vector<float> reflectionDecayGainsLeft;
-    std::vector<float> reflectionDecayGainsRight;
+    std::vector<SampleType> reflectionGains;
+    std::vector<SampleType> reflectionDecayGainsLeft;
+    std::vector<SampleType> reflectionDecayGainsRight;
+
+    std::array<StereoFieldManager<SampleType>, MAX_ECHOES + MAX_REFLECTIONS> stereoManagers;
+
+    // Rendered impulse response, owned by the worker once prepared
+    std::vector<SampleType> impulseLeft;
+    std::vector<SampleType> impulseRight;
+    std::array<int, DIFFUSE_TAPS> diffuseDelays {};
+    std::array<SampleType, DIFFUSE_TAPS> diffuseGainsLeft {};
+    std::array<SampleType, DIFFUSE_TAPS> diffuseGainsRight {};
+
+    // Mono sum of the input, the only signal the taps ever read
+    std::vector<SampleType> echoBuffer;
+    int echoBufferSize = 1;
+
+    // Per-block scratch
+    using Block = std::array<SampleType, DspKernels::MAX_BLOCK_SIZE>;
+    Block dampGains {};
+    Block outputLeft {};
+    Block outputRight {};
+    Block previousLeft {};
+    Block previousRight {};
+    Block monoInput {};
+
+    Biquad<SampleType> lowpassFilterLeft;
+    Biquad<SampleType> lowpassFilterRight;
 
-    std::array<StereoFieldManager, MAX_ECHOES + MAX_REFLECTIONS> stereoManagers;
+    int numActiveEchoes = 0;
+    int numActiveReflections = 0;
 
-    juce::AudioBuffer<float> echoBuffer;
+    // Audio thread side of the tap sets
+    TripleBuffer<TapSet> tapSets;
+    TapSet previousTaps;
+    SampleType tapCrossfadeGain = 1;
+    SampleType tapCrossfadeIncrement = 0;
+    SampleType lastRequestedDamp = 0;
 
-    juce::dsp::IIR::Coefficients<float>::Ptr lowpassCoeffsLeft;
-    juce::dsp::IIR::Filter<float> lowpassFilterLeft;
-    juce::dsp::IIR::Coefficients<float>::Ptr lowpassCoeffsRight;
-    juce::dsp::IIR::Filter<float> lowpassFilterRight;
+    std::atomic<SampleType> requestedDamp { SampleType(0) };
+    std::atomic<bool> impulseWanted { false };
+    std::atomic<bool> workerRunning { false };
+    std::atomic<bool> workPending { false };
+    std::mutex workerMutex;
+    std::condition_variable workerCondition;
+    std::thread worker;
 
-    int numActiveEchoes;
-    int numActiveReflections;
+    DampMode mode = DampMode::TapCloud;
+    FdnManager<SampleType> fdn;
+    ConvolutionManager<SampleType> convolution;
 
     std::mt19937 rng; // Random number generator
 };
@@ -1,27 +1,283 @@
+#pragma once
 
-#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "DspCommon.h"
+#include "DspKernels.h"
 
+template <typename SampleType>
 class DelayManager
 {
 public:
-    DelayManager();
-    
-    void prepare(const juce::dsp::ProcessSpec& spec, float initialDelayTime);
-    void reset();
-    
-    void setDelayTime(float delayTimeInSeconds);
-    void setFeedback(float newFeedback);
-    
-    float processSample(float inputSample);
-    
+    enum class DelayTimeMode
+    {
+        Glide,      // Read position follows the smoothed delay time every sample
+        Crossfade   // Fixed read head, crossfades to a second head on changes
+    };
+
+    DelayManager() = default;
+
+    void prepare(const EngineSpec& spec, SampleType initialDelayTime)
+    {
+        sampleRate = spec.sampleRate;
+
+        // Maximum 2 seconds delay, plus room for the interpolation neighbour
+        bufferSize = static_cast<int>(sampleRate * 2.0) + 2;
+        delayBuffer.assign(static_cast<size_t>(bufferSize) + 1, SampleType(0));
+        writePos = 0;
+
+        smoothedDelayTime.reset(sampleRate, 0.05);
+        smoothedDelayTime.setCurrentAndTargetValue(initialDelayTime * static_cast<SampleType>(sampleRate));
+
+        smoothedFeedback.reset(sampleRate, 0.05);
+        smoothedFeedback.setCurrentAndTargetValue(feedback);
+
+        crossfadeIncrement = SampleType(1) / (CROSSFADE_TIME * static_cast<SampleType>(sampleRate));
+        currentReadDelay = getTargetDelayInSamples();
+        nextReadDelay = currentReadDelay;
+        crossfadeGain = 0;
+        isCrossfading = false;
+    }
+
+    void reset()
+    {
+        std::fill(delayBuffer.begin(), delayBuffer.end(), SampleType(0));
+        writePos = 0;
+        crossfadeGain = 0;
+        isCrossfading = false;
+    }
+
+    void setDelayTime(SampleType delayTimeInSeconds)
+    {
+        smoothedDelayTime.setTargetValue(delayTimeInSeconds * static_cast<SampleType>(sampleRate));
+    }
+
+    void setFeedback(SampleType newFeedback)
+    {
+        smoothedFeedback.setTargetValue(newFeedback);
+    }
+
+    void setDelayTimeMode(DelayTimeMode newMode)
+    {
+        if (delayTimeMode == newMode)
+            return;
+
+        if (newMode == DelayTimeMode::Crossfade)
+        {
+            // Pick up from wherever the glide currently is
+            currentReadDelay = std::clamp(static_cast<int>(std::lround(smoothedDelayTime.getCurrentValue())),
+                                          1, bufferSize - 2);
+            nextReadDelay = currentReadDelay;
+            crossfadeGain = 0;
+            isCrossfading = false;
+        }
+        else
+        {
+            // Restart the glide from the head that is currently audible
+            SampleType target = smoothedDelayTime.getTargetValue();
+            smoothedDelayTime.setCurrentAndTargetValue(static_cast<SampleType>(isCrossfading ? nextReadDelay : currentReadDelay));
+            smoothedDelayTime.setTargetValue(target);
+            isCrossfading = false;
+        }
+
+        delayTimeMode = newMode;
+    }
+
+    // Longest block that can be read before it is written: every read in the
+    // block then lands on samples that were written before the block started
+    int getMaximumBlockSize() const
+    {
+        int shortestDelay;
+
+        if (delayTimeMode == DelayTimeMode::Crossfade)
+        {
+            shortestDelay = std::min(currentReadDelay, getTargetDelayInSamples());
+            if (isCrossfading)
+                shortestDelay = std::min(shortestDelay, nextReadDelay);
+        }
+        else
+        {
+            // The glide moves monotonically towards its target within a block
+            shortestDelay = static_cast<int>(std::min(smoothedDelayTime.getCurrentValue(),
+                                                      smoothedDelayTime.getTargetValue()));
+        }
+
+        return std::clamp(shortestDelay, 1, DspKernels::MAX_BLOCK_SIZE);
+    }
+
+    // Split read/write so the feedback signal can be mixed across lines:
+    // read every line first, then write each one with its mixed feedback
+    void readBlock(SampleType* dest, int numSamples)
+    {
+        if (delayTimeMode == DelayTimeMode::Crossfade)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = readCrossfadeSample(i);
+
+            return;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            // A delay of 1 returns the most recently written sample
+            SampleType delay = std::clamp(smoothedDelayTime.getNextValue(), SampleType(1),
+                                          static_cast<SampleType>(bufferSize - 2));
+            int delayInt = static_cast<int>(delay);
+            SampleType frac = delay - static_cast<SampleType>(delayInt);
+
+            // Interpolate from the older neighbour towards the newer one
+            int index = writePos + i - delayInt - 1;
+            if (index < 0)
+                index += bufferSize;
+
+            readIndices[i] = index;
+            readFractions[i] = SampleType(1) - frac;
+        }
+
+        DspKernels::get<SampleType>().interpolateLinear(dest, delayBuffer.data(), readIndices.data(),
+                                                        readFractions.data(), numSamples);
+    }
+
+    void writeBlock(const SampleType* input, const SampleType* feedbackSignal, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            feedbackGains[i] = smoothedFeedback.getNextValue();
+
+        auto& kernels = DspKernels::get<SampleType>();
+        int firstPart = std::min(numSamples, bufferSize - writePos);
+
+        kernels.writeWithFeedback(delayBuffer.data() + writePos, input, feedbackSignal,
+                                  feedbackGains.data(), firstPart);
+
+        if (firstPart < numSamples)
+            kernels.writeWithFeedback(delayBuffer.data(), input + firstPart, feedbackSignal + firstPart,
+                                      feedbackGains.data() + firstPart, numSamples - firstPart);
+
+        advanceWritePos(numSamples);
+    }
+
+    // Write-only path for inactive lines: keeps the buffer fed with input
+    // so the line holds recent audio when it is brought back in
+    void processStandbyBlock(const SampleType* input, int numSamples)
+    {
+        // Keep the smoothers moving so the line comes back at its current target
+        smoothedDelayTime.skip(numSamples);
+        smoothedFeedback.skip(numSamples);
+
+        // Nothing is audible, so a crossfading line can jump straight to its target
+        currentReadDelay = getTargetDelayInSamples();
+        isCrossfading = false;
+
+        copyToBuffer(input, numSamples);
+        advanceWritePos(numSamples);
+    }
+
+    // Makes this line a copy of one that has just read and written a block,
+    // for when both carry identical signals: only the written span and the
+    // scalar state are copied, so the reads are never repeated
+    void mirrorBlock(const DelayManager& source, int numSamples)
+    {
+        int start = source.writePos - numSamples;
+        if (start < 0)
+            start += bufferSize;
+
+        int firstPart = std::min(numSamples, bufferSize - start);
+        std::copy(source.delayBuffer.begin() + start, source.delayBuffer.begin() + start + firstPart,
+                  delayBuffer.begin() + start);
+        std::copy(source.delayBuffer.begin(), source.delayBuffer.begin() + (numSamples - firstPart), delayBuffer.begin());
+        delayBuffer[static_cast<size_t>(bufferSize)] = source.delayBuffer[static_cast<size_t>(bufferSize)];
+
+        writePos = source.writePos;
+        delayTimeMode = source.delayTimeMode;
+        currentReadDelay = source.currentReadDelay;
+        nextReadDelay = source.nextReadDelay;
+        crossfadeGain = source.crossfadeGain;
+        isCrossfading = source.isCrossfading;
+        smoothedDelayTime = source.smoothedDelayTime;
+        smoothedFeedback = source.smoothedFeedback;
+    }
+
 private:
-    juce::dsp::DelayLine<float, juce::dsp::DelayLineInterpolationTypes::Linear> delayLine;
-    juce::SmoothedValue<float> smoothedDelayTime;
-    juce::SmoothedValue<float> smoothedFeedback;
-    juce::SmoothedValue<float> smoothedWetLevel;
-    float feedback;
-    float wetLevel;
-    double sampleRate;
-    
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DelayManager)
+    SampleType readCrossfadeSample(int blockOffset)
+    {
+        if (! isCrossfading)
+        {
+            int targetDelay = getTargetDelayInSamples();
+
+            if (targetDelay == currentReadDelay)
+                return readSample(currentReadDelay, blockOffset);
+
+            // Start a second head at the new position; later changes wait for this fade
+            nextReadDelay = targetDelay;
+            crossfadeGain = 0;
+            isCrossfading = true;
+        }
+
+        SampleType currentHead = readSample(currentReadDelay, blockOffset);
+        SampleType nextHead = readSample(nextReadDelay, blockOffset);
+        SampleType output = currentHead + crossfadeGain * (nextHead - currentHead);
+
+        crossfadeGain += crossfadeIncrement;
+        if (crossfadeGain >= SampleType(1))
+        {
+            currentReadDelay = nextReadDelay;
+            isCrossfading = false;
+        }
+
+        return output;
+    }
+
+    SampleType readSample(int delayInSamples, int blockOffset) const
+    {
+        int index = writePos + blockOffset - delayInSamples;
+        if (index < 0)
+            index += bufferSize;
+
+        return delayBuffer[static_cast<size_t>(index)];
+    }
+
+    void copyToBuffer(const SampleType* input, int numSamples)
+    {
+        int firstPart = std::min(numSamples, bufferSize - writePos);
+
+        std::copy(input, input + firstPart, delayBuffer.begin() + writePos);
+        std::copy(input + firstPart, input + numSamples, delayBuffer.begin());
+    }
+
+    void advanceWritePos(int numSamples)
+    {
+        writePos += numSamples;
+        if (writePos >= bufferSize)
+            writePos -= bufferSize;
+
+        delayBuffer[static_cast<size_t>(bufferSize)] = delayBuffer[0];
+    }
+
+    int getTargetDelayInSamples() const
+    {
+        return std::clamp(static_cast<int>(std::lround(smoothedDelayTime.getTargetValue())), 1, bufferSize - 2);
+    }
+
+    static constexpr SampleType CROSSFADE_TIME = SampleType(0.02); // Crossfade window in seconds
+
+    // One guard sample past the end mirrors index 0, so interpolation never wraps
+    std::vector<SampleType> delayBuffer;
+    int bufferSize = 0;
+    int writePos = 0;
+
+    std::array<int, DspKernels::MAX_BLOCK_SIZE> readIndices {};
+    std::array<SampleType, DspKernels::MAX_BLOCK_SIZE> readFractions {};
+    std::array<SampleType, DspKernels::MAX_BLOCK_SIZE> feedbackGains {};
+
+    DelayTimeMode delayTimeMode = DelayTimeMode::Glide;
+    int currentReadDelay = 1;
+    int nextReadDelay = 1;
+    SampleType crossfadeGain = 0;
+    SampleType crossfadeIncrement = 0;
+    bool isCrossfading = false;
+
+    LinearSmoothedValue<SampleType> smoothedDelayTime;
+    LinearSmoothedValue<SampleType> smoothedFeedback;
+    SampleType feedback = SampleType(0.5);
+    double sampleRate = 44100.0;
 };
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "DspCommon.h"
+#include "DspKernels.h"
+
+// Cascade of Schroeder allpasses that smears the wet bus into a dense wash
+// without colouring it. Every allpass delay is at least one sub-block long,
+// so a whole block of each stage is computed at once by the kernel, with
+// consecutive samples in the vector lanes.
+template <typename SampleType>
+class DiffusionManager
+{
+public:
+    static constexpr int NUM_STAGES = 4;
+
+    void prepare(const EngineSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            for (int stage = 0; stage < NUM_STAGES; ++stage)
+            {
+                auto& allpass = allpasses[static_cast<size_t>(channel)][static_cast<size_t>(stage)];
+                SampleType delayMs = STAGE_DELAYS_MS[static_cast<size_t>(stage)] * (channel == 0 ? SampleType(1) : RIGHT_SPREAD);
+
+                allpass.delay = std::max(static_cast<int>(delayMs * SampleType(0.001) * static_cast<SampleType>(spec.sampleRate)),
+                                         DspKernels::MAX_BLOCK_SIZE);
+                allpass.gain = STAGE_GAINS[static_cast<size_t>(stage)];
+                allpass.buffer.assign(static_cast<size_t>(allpass.delay), SampleType(0));
+            }
+        }
+
+        smoothedAmount.reset(spec.sampleRate, 0.05);
+        smoothedAmount.setCurrentAndTargetValue(amount);
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& channel : allpasses)
+        {
+            for (auto& allpass : channel)
+            {
+                std::fill(allpass.buffer.begin(), allpass.buffer.end(), SampleType(0));
+                allpass.writePos = 0;
+            }
+        }
+
+        isActive = false;
+    }
+
+    // Time for an impulse through the whole cascade to fall 60 dB, on the
+    // slower channel: each stage rings for its delay times -3 / log10(gain)
+    double getTailSeconds() const
+    {
+        double longest = 0;
+
+        for (const auto& channel : allpasses)
+        {
+            double total = 0;
+            for (const auto& allpass : channel)
+                total += allpass.delay * -3.0 / std::log10(static_cast<double>(allpass.gain));
+
+            longest = std::max(longest, total);
+        }
+
+        return longest / sampleRate;
+    }
+
+    void setAmount(SampleType newAmount)
+    {
+        amount = std::clamp(newAmount, SampleType(0), SampleType(1));
+        smoothedAmount.setTargetValue(amount);
+    }
+
+    // Processes the wet bus in place; numSamples may not exceed DspKernels::MAX_BLOCK_SIZE
+    void processBlock(SampleType* left, SampleType* right, int numSamples)
+    {
+        SampleType firstAmount = smoothedAmount.getCurrentValue();
+
+        for (int i = 0; i < numSamples; ++i)
+            amounts[i] = smoothedAmount.getNextValue();
+
+        // Fully dry: skip the chain and start it empty when it comes back
+        if (std::max(firstAmount, amounts[numSamples - 1]) <= SampleType(0))
+        {
+            if (isActive)
+                reset();
+
+            return;
+        }
+
+        isActive = true;
+
+        std::copy(left, left + numSamples, diffusedLeft.begin());
+        std::copy(right, right + numSamples, diffusedRight.begin());
+
+        for (auto& allpass : allpasses[0])
+            processAllpass(allpass, diffusedLeft.data(), numSamples);
+
+        for (auto& allpass : allpasses[1])
+            processAllpass(allpass, diffusedRight.data(), numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            left[i] += amounts[i] * (diffusedLeft[i] - left[i]);
+            right[i] += amounts[i] * (diffusedRight[i] - right[i]);
+        }
+    }
+
+private:
+    struct Allpass
+    {
+        std::vector<SampleType> buffer;     // Exactly one delay long
+        int delay = DspKernels::MAX_BLOCK_SIZE;
+        int writePos = 0;
+        SampleType gain = SampleType(0.5);
+    };
+
+    // The read head sits one delay behind the write head, which in a buffer of
+    // exactly that length is the write head itself, so each sample is read and
+    // replaced in place. The block only needs splitting where it wraps.
+    void processAllpass(Allpass& allpass, SampleType* data, int numSamples)
+    {
+        auto& kernels = DspKernels::get<SampleType>();
+        int firstPart = std::min(numSamples, allpass.delay - allpass.writePos);
+        SampleType* head = allpass.buffer.data() + allpass.writePos;
+
+        kernels.processAllpass(data, head, head, allpass.gain, firstPart);
+
+        if (firstPart < numSamples)
+            kernels.processAllpass(data + firstPart, allpass.buffer.data(), allpass.buffer.data(),
+                                   allpass.gain, numSamples - firstPart);
+
+        allpass.writePos = (allpass.writePos + numSamples) % allpass.delay;
+    }
+
+    // Mutually prime-ish lengths from the classic plate input diffuser
+    static constexpr std::array<SampleType, NUM_STAGES> STAGE_DELAYS_MS { SampleType(4.77), SampleType(3.59),
+                                                                          SampleType(12.73), SampleType(9.30) };
+    static constexpr std::array<SampleType, NUM_STAGES> STAGE_GAINS { SampleType(0.75), SampleType(0.75),
+                                                                      SampleType(0.625), SampleType(0.625) };
+    static constexpr SampleType RIGHT_SPREAD = SampleType(1.037);  // Decorrelates the right channel
+
+    std::array<std::array<Allpass, NUM_STAGES>, 2> allpasses;
+
+    SampleType amount = 0;
+    LinearSmoothedValue<SampleType> smoothedAmount;
+    double sampleRate = 44100.0;
+    bool isActive = false;
+
+    // Per-block scratch
+    using Block = std::array<SampleType, DspKernels::MAX_BLOCK_SIZE>;
+    Block amounts {};
+    Block diffusedLeft {};
+    Block diffusedRight {};
+};
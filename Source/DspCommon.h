@@ -0,0 +1,241 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+// JUCE-free building blocks shared by the engine headers
+
+struct EngineSpec
+{
+    double sampleRate = 44100.0;
+    int maximumBlockSize = 512;
+    int numChannels = 2;
+};
+
+template <typename FloatType>
+struct EngineConstants
+{
+    static constexpr FloatType pi = static_cast<FloatType>(3.141592653589793238L);
+    static constexpr FloatType twoPi = static_cast<FloatType>(2.0L * 3.141592653589793238L);
+};
+
+// Linear ramp with the same behaviour as juce::SmoothedValue<FloatType, Linear>
+template <typename FloatType>
+class LinearSmoothedValue
+{
+public:
+    LinearSmoothedValue() = default;
+
+    explicit LinearSmoothedValue(FloatType initialValue)
+        : currentValue(initialValue), targetValue(initialValue)
+    {
+    }
+
+    void reset(double sampleRate, double rampLengthInSeconds)
+    {
+        stepsToTarget = static_cast<int>(std::floor(rampLengthInSeconds * sampleRate));
+        setCurrentAndTargetValue(targetValue);
+    }
+
+    void setCurrentAndTargetValue(FloatType newValue)
+    {
+        targetValue = currentValue = newValue;
+        countdown = 0;
+    }
+
+    void setTargetValue(FloatType newValue)
+    {
+        if (newValue == targetValue)
+            return;
+
+        if (stepsToTarget <= 0)
+        {
+            setCurrentAndTargetValue(newValue);
+            return;
+        }
+
+        targetValue = newValue;
+        countdown = stepsToTarget;
+        step = (targetValue - currentValue) / static_cast<FloatType>(countdown);
+    }
+
+    FloatType getNextValue()
+    {
+        if (! isSmoothing())
+            return targetValue;
+
+        --countdown;
+
+        if (isSmoothing())
+            currentValue += step;
+        else
+            currentValue = targetValue;
+
+        return currentValue;
+    }
+
+    FloatType skip(int numSamples)
+    {
+        if (numSamples >= countdown)
+        {
+            setCurrentAndTargetValue(targetValue);
+            return targetValue;
+        }
+
+        currentValue += step * static_cast<FloatType>(numSamples);
+        countdown -= numSamples;
+        return currentValue;
+    }
+
+    bool isSmoothing() const { return countdown > 0; }
+    FloatType getCurrentValue() const { return currentValue; }
+    FloatType getTargetValue() const { return targetValue; }
+
+private:
+    FloatType currentValue = 0;
+    FloatType targetValue = 0;
+    FloatType step = 0;
+    int countdown = 0;
+    int stepsToTarget = 0;
+};
+
+// Transposed direct form II biquad, matching juce::dsp::IIR::Filter
+template <typename FloatType>
+class Biquad
+{
+public:
+    // Same design as juce::dsp::IIR::Coefficients::makeLowPass, with the
+    // cutoff kept below Nyquist so lower internal rates stay stable
+    void setLowPass(double sampleRate, FloatType frequency, FloatType q = static_cast<FloatType>(0.70710678118654752))
+    {
+        const double cutoff = std::clamp(static_cast<double>(frequency), 1.0, sampleRate * 0.49);
+        const FloatType n = static_cast<FloatType>(1.0 / std::tan(EngineConstants<double>::pi * cutoff / sampleRate));
+        const FloatType nSquared = n * n;
+        const FloatType invQ = static_cast<FloatType>(1) / q;
+        const FloatType c1 = static_cast<FloatType>(1) / (static_cast<FloatType>(1) + invQ * n + nSquared);
+
+        b0 = c1;
+        b1 = c1 * static_cast<FloatType>(2);
+        b2 = c1;
+        a1 = c1 * static_cast<FloatType>(2) * (static_cast<FloatType>(1) - nSquared);
+        a2 = c1 * (static_cast<FloatType>(1) - invQ * n + nSquared);
+    }
+
+    void reset()
+    {
+        s1 = s2 = 0;
+    }
+
+    FloatType processSample(FloatType input)
+    {
+        const FloatType output = b0 * input + s1;
+        s1 = b1 * input - a1 * output + s2;
+        s2 = b2 * input - a2 * output;
+        return output;
+    }
+
+private:
+    FloatType b0 = 1, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+    FloatType s1 = 0, s2 = 0;
+};
+
+// Whole-sample delay used to line signals up with a latency elsewhere
+template <typename FloatType>
+class FixedDelay
+{
+public:
+    void prepare(int maximumDelay)
+    {
+        buffer.assign(static_cast<size_t>(maximumDelay) + 1, static_cast<FloatType>(0));
+        reset();
+    }
+
+    void reset()
+    {
+        std::fill(buffer.begin(), buffer.end(), static_cast<FloatType>(0));
+        writePos = 0;
+    }
+
+    void setDelay(int newDelay)
+    {
+        delay = std::clamp(newDelay, 0, static_cast<int>(buffer.size()) - 1);
+    }
+
+    int getDelay() const { return delay; }
+
+    FloatType processSample(FloatType input)
+    {
+        const int size = static_cast<int>(buffer.size());
+
+        buffer[static_cast<size_t>(writePos)] = input;
+
+        int readPos = writePos - delay;
+        if (readPos < 0)
+            readPos += size;
+
+        if (++writePos >= size)
+            writePos = 0;
+
+        return buffer[static_cast<size_t>(readPos)];
+    }
+
+private:
+    std::vector<FloatType> buffer { static_cast<FloatType>(0) };
+    int writePos = 0;
+    int delay = 0;
+};
+
+// Single-producer, single-consumer triple buffer. The writer fills
+// getWriteBuffer() and calls publish(); the reader calls update() and then
+// reads getReadBuffer(). Neither side ever waits for the other, and the
+// reader's buffer is never touched by the writer until update() hands it back.
+template <typename Type>
+class TripleBuffer
+{
+public:
+    Type& getWriteBuffer() { return buffers[static_cast<size_t>(writeIndex)]; }
+
+    void publish()
+    {
+        writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    bool hasUpdate() const
+    {
+        return (middle.load(std::memory_order_acquire) & FRESH) != 0;
+    }
+
+    // Returns true if a newer buffer was taken over
+    bool update()
+    {
+        if (! hasUpdate())
+            return false;
+
+        readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const Type& getReadBuffer() const { return buffers[static_cast<size_t>(readIndex)]; }
+
+    // Fills all three buffers, e.g. to preallocate them. Only call this
+    // while neither the reader nor the writer is running.
+    void resetAll(const Type& value)
+    {
+        buffers.fill(value);
+        middle.store(1);
+        writeIndex = 0;
+        readIndex = 2;
+    }
+
+private:
+    static constexpr int INDEX_MASK = 3;
+    static constexpr int FRESH = 4;
+
+    std::array<Type, 3> buffers {};
+    std::atomic<int> middle { 1 };
+    int writeIndex = 0;
+    int readIndex = 2;
+};
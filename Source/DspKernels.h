@@ -0,0 +1,676 @@
+#pragma once
+
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+ #define QUANTA_KERNELS_X86 1
+ #include <immintrin.h>
+ #if defined(__GNUC__) || defined(__clang__)
+  #define QUANTA_TARGET(isa) __attribute__((target(isa)))
+ #else
+  #include <intrin.h>
+  #define QUANTA_TARGET(isa)
+ #endif
+#else
+ #define QUANTA_KERNELS_X86 0
+#endif
+
+// Block kernels for the hot loops, compiled for several instruction sets and
+// dispatched once at startup. The scalar table is the reference implementation.
+namespace DspKernels
+{
+    // Sub-block length the DSP stages size their scratch buffers for
+    static constexpr int MAX_BLOCK_SIZE = 64;
+
+    // Longest state variable filter cascade: 48 dB/octave high-pass plus low-pass
+    static constexpr int MAX_SVF_STAGES = 8;
+
+    enum class InstructionSet
+    {
+        Scalar,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    template <typename SampleType>
+    struct SvfState
+    {
+        SampleType s1[2] = { 0, 0 };    // Left, right
+        SampleType s2[2] = { 0, 0 };
+    };
+
+    template <typename SampleType>
+    struct SvfCoefficients
+    {
+        SampleType g = 0;               // tan(pi * cutoff / sampleRate)
+        SampleType r2 = 1;              // 1 / Q
+        SampleType h = 1;               // 1 / (1 + r2 * g + g * g)
+        SampleType lowPassMix = 1;
+        SampleType bandPassMix = 0;
+        SampleType highPassMix = 0;
+    };
+
+    template <typename SampleType>
+    struct KernelTable
+    {
+        // Delay bank: dest[i] = input[i] + feedback[i] * gains[i]
+        void (*writeWithFeedback)(SampleType* dest, const SampleType* input, const SampleType* feedback,
+                                  const SampleType* gains, int numSamples);
+
+        // Taps: dest[i] += source[i] * gain
+        void (*addWithMultiply)(SampleType* dest, const SampleType* source, SampleType gain, int numSamples);
+
+        // Interpolation: dest[i] = lerp(source[indices[i]], source[indices[i] + 1], fractions[i])
+        void (*interpolateLinear)(SampleType* dest, const SampleType* source, const int* indices,
+                                  const SampleType* fractions, int numSamples);
+
+        // Filter: cascade of TPT state variable filters, left and right run as two lanes.
+        // g and r2 move linearly from `from` to `to` across the block, reaching `to` on
+        // the last sample, and h is recomputed from them while they move: a linearly
+        // interpolated h goes unstable for cutoffs near Nyquist. The mixes come from
+        // `to`. numStages may not exceed MAX_SVF_STAGES.
+        void (*processSvfStereo)(SvfState<SampleType>* states, const SvfCoefficients<SampleType>* from,
+                                 const SvfCoefficients<SampleType>* to, int numStages,
+                                 SampleType* left, SampleType* right, int numSamples);
+
+        // Schroeder allpass over a block no longer than its delay, so every delayed
+        // sample is already known: state[i] = data[i] + gain * delayed[i],
+        // data[i] = delayed[i] - gain * state[i]. state may alias delayed.
+        void (*processAllpass)(SampleType* data, const SampleType* delayed, SampleType* state,
+                               SampleType gain, int numSamples);
+
+        // Compare: true if a[i] == b[i] for every sample
+        bool (*isEqual)(const SampleType* a, const SampleType* b, int numSamples);
+
+        InstructionSet instructionSet;
+        const char* name;
+    };
+
+    namespace detail
+    {
+        //==============================================================================
+        // Scalar reference
+        template <typename SampleType>
+        void writeWithFeedbackScalar(SampleType* dest, const SampleType* input, const SampleType* feedback,
+                                     const SampleType* gains, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = input[i] + feedback[i] * gains[i];
+        }
+
+        template <typename SampleType>
+        void addWithMultiplyScalar(SampleType* dest, const SampleType* source, SampleType gain, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] += source[i] * gain;
+        }
+
+        template <typename SampleType>
+        void interpolateLinearScalar(SampleType* dest, const SampleType* source, const int* indices,
+                                     const SampleType* fractions, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                SampleType sample0 = source[indices[i]];
+                SampleType sample1 = source[indices[i] + 1];
+                dest[i] = sample0 + fractions[i] * (sample1 - sample0);
+            }
+        }
+
+        template <typename SampleType>
+        void processSvfStereoScalar(SvfState<SampleType>* states, const SvfCoefficients<SampleType>* from,
+                                    const SvfCoefficients<SampleType>* to, int numStages,
+                                    SampleType* left, SampleType* right, int numSamples)
+        {
+            SampleType* channels[2] = { left, right };
+            SampleType rampScale = SampleType(1) / static_cast<SampleType>(numSamples);
+
+            // The stages are linear, so each can run over the whole block in turn
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                auto& state = states[stage];
+                auto& c = to[stage];
+                SampleType gStep = (c.g - from[stage].g) * rampScale;
+                SampleType r2Step = (c.r2 - from[stage].r2) * rampScale;
+                bool ramping = gStep != 0 || r2Step != 0;
+
+                for (int channel = 0; channel < 2; ++channel)
+                {
+                    SampleType s1 = state.s1[channel];
+                    SampleType s2 = state.s2[channel];
+                    SampleType g = from[stage].g;
+                    SampleType r2 = from[stage].r2;
+                    SampleType h = from[stage].h;
+                    SampleType* data = channels[channel];
+
+                    for (int i = 0; i < numSamples; ++i)
+                    {
+                        g += gStep;
+                        r2 += r2Step;
+
+                        if (ramping)
+                            h = SampleType(1) / (SampleType(1) + r2 * g + g * g);
+
+                        SampleType highPass = h * (data[i] - s1 * (g + r2) - s2);
+                        SampleType bandPass = highPass * g + s1;
+                        s1 = highPass * g + bandPass;
+                        SampleType lowPass = bandPass * g + s2;
+                        s2 = bandPass * g + lowPass;
+
+                        data[i] = c.lowPassMix * lowPass + c.bandPassMix * bandPass + c.highPassMix * highPass;
+                    }
+
+                    state.s1[channel] = s1;
+                    state.s2[channel] = s2;
+                }
+            }
+        }
+
+        template <typename SampleType>
+        void processAllpassScalar(SampleType* data, const SampleType* delayed, SampleType* state,
+                                  SampleType gain, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                SampleType delayedSample = delayed[i];
+                SampleType value = data[i] + gain * delayedSample;
+                data[i] = delayedSample - gain * value;
+                state[i] = value;
+            }
+        }
+
+        template <typename SampleType>
+        bool isEqualScalar(const SampleType* a, const SampleType* b, int numSamples)
+        {
+            for (int i = 0; i < numSamples; ++i)
+                if (a[i] != b[i])
+                    return false;
+
+            return true;
+        }
+
+       #if QUANTA_KERNELS_X86
+        //==============================================================================
+        // SSE2
+        QUANTA_TARGET("sse2")
+        inline void writeWithFeedbackSSE2(float* dest, const float* input, const float* feedback,
+                                          const float* gains, int numSamples)
+        {
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                __m128 product = _mm_mul_ps(_mm_loadu_ps(feedback + i), _mm_loadu_ps(gains + i));
+                _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(input + i), product));
+            }
+
+            writeWithFeedbackScalar(dest + i, input + i, feedback + i, gains + i, numSamples - i);
+        }
+
+        QUANTA_TARGET("sse2")
+        inline void addWithMultiplySSE2(float* dest, const float* source, float gain, int numSamples)
+        {
+            __m128 gainVector = _mm_set1_ps(gain);
+
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                __m128 product = _mm_mul_ps(_mm_loadu_ps(source + i), gainVector);
+                _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), product));
+            }
+
+            addWithMultiplyScalar(dest + i, source + i, gain, numSamples - i);
+        }
+
+        QUANTA_TARGET("sse2")
+        inline void interpolateLinearSSE2(float* dest, const float* source, const int* indices,
+                                          const float* fractions, int numSamples)
+        {
+            // No gather before AVX2, so only the arithmetic is vectorised
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                __m128 sample0 = _mm_setr_ps(source[indices[i]], source[indices[i + 1]],
+                                             source[indices[i + 2]], source[indices[i + 3]]);
+                __m128 sample1 = _mm_setr_ps(source[indices[i] + 1], source[indices[i + 1] + 1],
+                                             source[indices[i + 2] + 1], source[indices[i + 3] + 1]);
+                __m128 difference = _mm_mul_ps(_mm_loadu_ps(fractions + i), _mm_sub_ps(sample1, sample0));
+                _mm_storeu_ps(dest + i, _mm_add_ps(sample0, difference));
+            }
+
+            interpolateLinearScalar(dest + i, source, indices + i, fractions + i, numSamples - i);
+        }
+
+        QUANTA_TARGET("sse2")
+        inline void processSvfStereoSSE2(SvfState<float>* states, const SvfCoefficients<float>* from,
+                                         const SvfCoefficients<float>* to, int numStages,
+                                         float* left, float* right, int numSamples)
+        {
+            // The recursion runs along time, so the lanes are the channels: [left, right, -, -].
+            // Wider registers have nothing more to fill here, so AVX2/AVX-512 reuse this one.
+            // The whole cascade stays in registers for the block, so a steeper
+            // slope costs one more stage of arithmetic and nothing else.
+            __m128 s1[MAX_SVF_STAGES], s2[MAX_SVF_STAGES];
+            __m128 g[MAX_SVF_STAGES], r2[MAX_SVF_STAGES], h[MAX_SVF_STAGES];
+            __m128 gStep[MAX_SVF_STAGES], r2Step[MAX_SVF_STAGES];
+            __m128 lowPassMix[MAX_SVF_STAGES], bandPassMix[MAX_SVF_STAGES], highPassMix[MAX_SVF_STAGES];
+
+            float rampScale = 1.0f / static_cast<float>(numSamples);
+            bool ramping = false;
+
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                auto& c = to[stage];
+                s1[stage] = _mm_setr_ps(states[stage].s1[0], states[stage].s1[1], 0.0f, 0.0f);
+                s2[stage] = _mm_setr_ps(states[stage].s2[0], states[stage].s2[1], 0.0f, 0.0f);
+                g[stage] = _mm_set1_ps(from[stage].g);
+                r2[stage] = _mm_set1_ps(from[stage].r2);
+                h[stage] = _mm_set1_ps(from[stage].h);
+                gStep[stage] = _mm_set1_ps((c.g - from[stage].g) * rampScale);
+                r2Step[stage] = _mm_set1_ps((c.r2 - from[stage].r2) * rampScale);
+                ramping = ramping || c.g != from[stage].g || c.r2 != from[stage].r2;
+                lowPassMix[stage] = _mm_set1_ps(c.lowPassMix);
+                bandPassMix[stage] = _mm_set1_ps(c.bandPassMix);
+                highPassMix[stage] = _mm_set1_ps(c.highPassMix);
+            }
+
+            const __m128 one = _mm_set1_ps(1.0f);
+            alignas(16) float lanes[4];
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                __m128 signal = _mm_setr_ps(left[i], right[i], 0.0f, 0.0f);
+
+                for (int stage = 0; stage < numStages; ++stage)
+                {
+                    g[stage] = _mm_add_ps(g[stage], gStep[stage]);
+                    r2[stage] = _mm_add_ps(r2[stage], r2Step[stage]);
+
+                    if (ramping)
+                        h[stage] = _mm_div_ps(one, _mm_add_ps(one, _mm_mul_ps(g[stage], _mm_add_ps(r2[stage], g[stage]))));
+
+                    __m128 gPlusR2 = _mm_add_ps(g[stage], r2[stage]);
+                    __m128 highPass = _mm_mul_ps(h[stage], _mm_sub_ps(_mm_sub_ps(signal, _mm_mul_ps(s1[stage], gPlusR2)), s2[stage]));
+                    __m128 bandPass = _mm_add_ps(_mm_mul_ps(highPass, g[stage]), s1[stage]);
+                    s1[stage] = _mm_add_ps(_mm_mul_ps(highPass, g[stage]), bandPass);
+                    __m128 lowPass = _mm_add_ps(_mm_mul_ps(bandPass, g[stage]), s2[stage]);
+                    s2[stage] = _mm_add_ps(_mm_mul_ps(bandPass, g[stage]), lowPass);
+
+                    signal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(lowPassMix[stage], lowPass),
+                                                   _mm_mul_ps(bandPassMix[stage], bandPass)),
+                                        _mm_mul_ps(highPassMix[stage], highPass));
+                }
+
+                _mm_store_ps(lanes, signal);
+                left[i] = lanes[0];
+                right[i] = lanes[1];
+            }
+
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                _mm_store_ps(lanes, s1[stage]);
+                states[stage].s1[0] = lanes[0];
+                states[stage].s1[1] = lanes[1];
+                _mm_store_ps(lanes, s2[stage]);
+                states[stage].s2[0] = lanes[0];
+                states[stage].s2[1] = lanes[1];
+            }
+        }
+
+        QUANTA_TARGET("sse2")
+        inline void processAllpassSSE2(float* data, const float* delayed, float* state, float gain, int numSamples)
+        {
+            __m128 gainVector = _mm_set1_ps(gain);
+
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+            {
+                __m128 delayedVector = _mm_loadu_ps(delayed + i);
+                __m128 value = _mm_add_ps(_mm_loadu_ps(data + i), _mm_mul_ps(gainVector, delayedVector));
+                _mm_storeu_ps(state + i, value);
+                _mm_storeu_ps(data + i, _mm_sub_ps(delayedVector, _mm_mul_ps(gainVector, value)));
+            }
+
+            processAllpassScalar(data + i, delayed + i, state + i, gain, numSamples - i);
+        }
+
+        QUANTA_TARGET("sse2")
+        inline bool isEqualSSE2(const float* a, const float* b, int numSamples)
+        {
+            int i = 0;
+            for (; i + 4 <= numSamples; i += 4)
+                if (_mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i))) != 0xf)
+                    return false;
+
+            return isEqualScalar(a + i, b + i, numSamples - i);
+        }
+
+        //==============================================================================
+        // AVX2 + FMA
+        QUANTA_TARGET("avx2,fma")
+        inline void writeWithFeedbackAVX2(float* dest, const float* input, const float* feedback,
+                                          const float* gains, int numSamples)
+        {
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                __m256 result = _mm256_fmadd_ps(_mm256_loadu_ps(feedback + i), _mm256_loadu_ps(gains + i),
+                                                _mm256_loadu_ps(input + i));
+                _mm256_storeu_ps(dest + i, result);
+            }
+
+            writeWithFeedbackScalar(dest + i, input + i, feedback + i, gains + i, numSamples - i);
+        }
+
+        QUANTA_TARGET("avx2,fma")
+        inline void addWithMultiplyAVX2(float* dest, const float* source, float gain, int numSamples)
+        {
+            __m256 gainVector = _mm256_set1_ps(gain);
+
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                __m256 result = _mm256_fmadd_ps(_mm256_loadu_ps(source + i), gainVector, _mm256_loadu_ps(dest + i));
+                _mm256_storeu_ps(dest + i, result);
+            }
+
+            addWithMultiplyScalar(dest + i, source + i, gain, numSamples - i);
+        }
+
+        QUANTA_TARGET("avx2,fma")
+        inline void interpolateLinearAVX2(float* dest, const float* source, const int* indices,
+                                          const float* fractions, int numSamples)
+        {
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(indices + i));
+                __m256 sample0 = _mm256_i32gather_ps(source, index, 4);
+                __m256 sample1 = _mm256_i32gather_ps(source + 1, index, 4);
+                __m256 result = _mm256_fmadd_ps(_mm256_loadu_ps(fractions + i), _mm256_sub_ps(sample1, sample0), sample0);
+                _mm256_storeu_ps(dest + i, result);
+            }
+
+            interpolateLinearScalar(dest + i, source, indices + i, fractions + i, numSamples - i);
+        }
+
+        QUANTA_TARGET("avx2,fma")
+        inline void processAllpassAVX2(float* data, const float* delayed, float* state, float gain, int numSamples)
+        {
+            __m256 gainVector = _mm256_set1_ps(gain);
+
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+            {
+                __m256 delayedVector = _mm256_loadu_ps(delayed + i);
+                __m256 value = _mm256_fmadd_ps(gainVector, delayedVector, _mm256_loadu_ps(data + i));
+                _mm256_storeu_ps(state + i, value);
+                _mm256_storeu_ps(data + i, _mm256_fnmadd_ps(gainVector, value, delayedVector));
+            }
+
+            processAllpassScalar(data + i, delayed + i, state + i, gain, numSamples - i);
+        }
+
+        QUANTA_TARGET("avx2,fma")
+        inline bool isEqualAVX2(const float* a, const float* b, int numSamples)
+        {
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+                if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), _CMP_EQ_OQ)) != 0xff)
+                    return false;
+
+            return isEqualScalar(a + i, b + i, numSamples - i);
+        }
+
+        //==============================================================================
+        // AVX-512
+        QUANTA_TARGET("avx512f")
+        inline void writeWithFeedbackAVX512(float* dest, const float* input, const float* feedback,
+                                            const float* gains, int numSamples)
+        {
+            int i = 0;
+            for (; i + 16 <= numSamples; i += 16)
+            {
+                __m512 result = _mm512_fmadd_ps(_mm512_loadu_ps(feedback + i), _mm512_loadu_ps(gains + i),
+                                                _mm512_loadu_ps(input + i));
+                _mm512_storeu_ps(dest + i, result);
+            }
+
+            writeWithFeedbackAVX2(dest + i, input + i, feedback + i, gains + i, numSamples - i);
+        }
+
+        QUANTA_TARGET("avx512f")
+        inline void addWithMultiplyAVX512(float* dest, const float* source, float gain, int numSamples)
+        {
+            __m512 gainVector = _mm512_set1_ps(gain);
+
+            int i = 0;
+            for (; i + 16 <= numSamples; i += 16)
+            {
+                __m512 result = _mm512_fmadd_ps(_mm512_loadu_ps(source + i), gainVector, _mm512_loadu_ps(dest + i));
+                _mm512_storeu_ps(dest + i, result);
+            }
+
+            addWithMultiplyAVX2(dest + i, source + i, gain, numSamples - i);
+        }
+
+        QUANTA_TARGET("avx512f")
+        inline void interpolateLinearAVX512(float* dest, const float* source, const int* indices,
+                                            const float* fractions, int numSamples)
+        {
+            // The masked gather with an explicit zero source: the plain one leaves
+            // its pass-through operand undefined, which GCC reports as uninitialised
+            const __m512 zero = _mm512_setzero_ps();
+            const __mmask16 allLanes = 0xffff;
+
+            int i = 0;
+            for (; i + 16 <= numSamples; i += 16)
+            {
+                __m512i index = _mm512_loadu_si512(indices + i);
+                __m512 sample0 = _mm512_mask_i32gather_ps(zero, allLanes, index, source, 4);
+                __m512 sample1 = _mm512_mask_i32gather_ps(zero, allLanes, index, source + 1, 4);
+                __m512 result = _mm512_fmadd_ps(_mm512_loadu_ps(fractions + i), _mm512_sub_ps(sample1, sample0), sample0);
+                _mm512_storeu_ps(dest + i, result);
+            }
+
+            interpolateLinearAVX2(dest + i, source, indices + i, fractions + i, numSamples - i);
+        }
+
+        QUANTA_TARGET("avx512f")
+        inline void processAllpassAVX512(float* data, const float* delayed, float* state, float gain, int numSamples)
+        {
+            __m512 gainVector = _mm512_set1_ps(gain);
+
+            int i = 0;
+            for (; i + 16 <= numSamples; i += 16)
+            {
+                __m512 delayedVector = _mm512_loadu_ps(delayed + i);
+                __m512 value = _mm512_fmadd_ps(gainVector, delayedVector, _mm512_loadu_ps(data + i));
+                _mm512_storeu_ps(state + i, value);
+                _mm512_storeu_ps(data + i, _mm512_fnmadd_ps(gainVector, value, delayedVector));
+            }
+
+            processAllpassAVX2(data + i, delayed + i, state + i, gain, numSamples - i);
+        }
+
+        QUANTA_TARGET("avx512f")
+        inline bool isEqualAVX512(const float* a, const float* b, int numSamples)
+        {
+            int i = 0;
+            for (; i + 16 <= numSamples; i += 16)
+                if (_mm512_cmp_ps_mask(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), _CMP_EQ_OQ) != 0xffff)
+                    return false;
+
+            return isEqualAVX2(a + i, b + i, numSamples - i);
+        }
+       #endif
+
+        //==============================================================================
+        template <typename SampleType>
+        inline const KernelTable<SampleType> scalarTable
+        {
+            writeWithFeedbackScalar<SampleType>,
+            addWithMultiplyScalar<SampleType>,
+            interpolateLinearScalar<SampleType>,
+            processSvfStereoScalar<SampleType>,
+            processAllpassScalar<SampleType>,
+            isEqualScalar<SampleType>,
+            InstructionSet::Scalar,
+            "Scalar"
+        };
+
+       #if QUANTA_KERNELS_X86
+        inline const KernelTable<float> sse2Table
+        {
+            writeWithFeedbackSSE2,
+            addWithMultiplySSE2,
+            interpolateLinearSSE2,
+            processSvfStereoSSE2,
+            processAllpassSSE2,
+            isEqualSSE2,
+            InstructionSet::SSE2,
+            "SSE2"
+        };
+
+        inline const KernelTable<float> avx2Table
+        {
+            writeWithFeedbackAVX2,
+            addWithMultiplyAVX2,
+            interpolateLinearAVX2,
+            processSvfStereoSSE2,
+            processAllpassAVX2,
+            isEqualAVX2,
+            InstructionSet::AVX2,
+            "AVX2"
+        };
+
+        inline const KernelTable<float> avx512Table
+        {
+            writeWithFeedbackAVX512,
+            addWithMultiplyAVX512,
+            interpolateLinearAVX512,
+            processSvfStereoSSE2,
+            processAllpassAVX512,
+            isEqualAVX512,
+            InstructionSet::AVX512,
+            "AVX-512"
+        };
+       #endif
+
+        //==============================================================================
+        struct CpuFeatures
+        {
+            bool sse2 = false;
+            bool avx2 = false;
+            bool fma = false;
+            bool avx512f = false;
+        };
+
+        inline CpuFeatures detectCpuFeatures()
+        {
+            CpuFeatures features;
+
+           #if QUANTA_KERNELS_X86
+            #if defined(__GNUC__) || defined(__clang__)
+             // These also check that the OS saves the wide register state
+             __builtin_cpu_init();
+             features.sse2 = __builtin_cpu_supports("sse2");
+             features.avx2 = __builtin_cpu_supports("avx2");
+             features.fma = __builtin_cpu_supports("fma");
+             features.avx512f = __builtin_cpu_supports("avx512f");
+            #elif defined(_MSC_VER)
+             int info[4];
+             __cpuid(info, 0);
+             int highestLeaf = info[0];
+
+             __cpuid(info, 1);
+             features.sse2 = (info[3] & (1 << 26)) != 0;
+             bool osSavesState = (info[2] & (1 << 27)) != 0;
+             unsigned long long enabledState = osSavesState ? _xgetbv(0) : 0;
+             bool avxStateEnabled = (enabledState & 0x06) == 0x06;
+             bool avx512StateEnabled = (enabledState & 0xe6) == 0xe6;
+             features.fma = avxStateEnabled && (info[2] & (1 << 12)) != 0;
+
+             if (highestLeaf >= 7)
+             {
+                 __cpuidex(info, 7, 0);
+                 features.avx2 = avxStateEnabled && (info[1] & (1 << 5)) != 0;
+                 features.avx512f = avx512StateEnabled && (info[1] & (1 << 16)) != 0;
+             }
+            #endif
+           #endif
+
+            return features;
+        }
+
+        inline const CpuFeatures& getCpuFeatures()
+        {
+            static const CpuFeatures features = detectCpuFeatures();
+            return features;
+        }
+    }
+
+    inline bool isSupported(InstructionSet instructionSet)
+    {
+        auto& cpu = detail::getCpuFeatures();
+
+        switch (instructionSet)
+        {
+            case InstructionSet::Scalar:  return true;
+            case InstructionSet::SSE2:    return cpu.sse2;
+            case InstructionSet::AVX2:    return cpu.avx2 && cpu.fma;
+            case InstructionSet::AVX512:  return cpu.avx512f && cpu.avx2 && cpu.fma;
+        }
+
+        return false;
+    }
+
+    // Portable reference path, used to check the vector paths against
+    template <typename SampleType>
+    const KernelTable<SampleType>& getScalar()
+    {
+        return detail::scalarTable<SampleType>;
+    }
+
+    // Returns nullptr if the table was not compiled in or the CPU lacks support
+    template <typename SampleType>
+    const KernelTable<SampleType>* getForInstructionSet(InstructionSet instructionSet)
+    {
+        if (! isSupported(instructionSet))
+            return nullptr;
+
+        if (instructionSet == InstructionSet::Scalar)
+            return &detail::scalarTable<SampleType>;
+
+       #if QUANTA_KERNELS_X86
+        if constexpr (std::is_same_v<SampleType, float>)
+        {
+            switch (instructionSet)
+            {
+                case InstructionSet::SSE2:    return &detail::sse2Table;
+                case InstructionSet::AVX2:    return &detail::avx2Table;
+                case InstructionSet::AVX512:  return &detail::avx512Table;
+                default:                      break;
+            }
+        }
+       #endif
+
+        return nullptr;
+    }
+
+    // The best table for this CPU, detected on first use
+    template <typename SampleType>
+    const KernelTable<SampleType>& get()
+    {
+        static const KernelTable<SampleType>& selectedTable = []() -> const KernelTable<SampleType>&
+        {
+            for (auto instructionSet : { InstructionSet::AVX512, InstructionSet::AVX2, InstructionSet::SSE2 })
+                if (auto* table = getForInstructionSet<SampleType>(instructionSet))
+                    return *table;
+
+            return getScalar<SampleType>();
+        }();
+
+        return selectedTable;
+    }
+}
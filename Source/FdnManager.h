@@ -0,0 +1,218 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include "DspCommon.h"
+
+// Feedback delay network: 8 or 16 modulated delay lines mixed through a
+// Hadamard matrix every sample. The state is held line-major in fixed
+// arrays, so every per-line step is a straight loop across the lines that
+// the compiler vectorises, and the cost per sample never changes.
+template <typename SampleType>
+class FdnManager
+{
+public:
+    static constexpr int MAX_LINES = 16;
+
+    FdnManager() = default;
+
+    void prepare(const EngineSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+
+        // Room for the longest line plus its modulation and interpolation
+        int requiredSize = static_cast<int>(std::ceil(MAX_DELAY_TIME * sampleRate + MODULATION_DEPTH)) + 4;
+
+        bufferSize = 1;
+        while (bufferSize < requiredSize)
+            bufferSize <<= 1;
+
+        bufferMask = bufferSize - 1;
+
+        for (auto& buffer : buffers)
+            buffer.assign(static_cast<size_t>(bufferSize), SampleType(0));
+
+        // Slow, unrelated rates so the lines never modulate in step
+        for (int i = 0; i < MAX_LINES; ++i)
+        {
+            double rate = 0.13 + 0.071 * i;
+            double angle = EngineConstants<double>::twoPi * rate / sampleRate;
+            rotationCos[static_cast<size_t>(i)] = static_cast<SampleType>(std::cos(angle));
+            rotationSin[static_cast<size_t>(i)] = static_cast<SampleType>(std::sin(angle));
+        }
+
+        reset();
+        updateLines();
+    }
+
+    void reset()
+    {
+        for (auto& buffer : buffers)
+            std::fill(buffer.begin(), buffer.end(), SampleType(0));
+
+        writePos = 0;
+        lowpassState.fill(0);
+
+        // Start every oscillator at a different phase
+        for (int i = 0; i < MAX_LINES; ++i)
+        {
+            SampleType phase = EngineConstants<SampleType>::twoPi * static_cast<SampleType>(i) / MAX_LINES;
+            oscillatorCos[static_cast<size_t>(i)] = std::cos(phase);
+            oscillatorSin[static_cast<size_t>(i)] = std::sin(phase);
+        }
+    }
+
+    // 8 or 16
+    void setNumLines(int newNumLines)
+    {
+        newNumLines = newNumLines > 8 ? MAX_LINES : 8;
+
+        if (numLines != newNumLines)
+        {
+            numLines = newNumLines;
+            updateLines();
+        }
+    }
+
+    int getNumLines() const { return numLines; }
+
+    // Time for the tail to fall by 60 dB
+    void setDecayTime(SampleType newDecayTime)
+    {
+        if (decayTime != newDecayTime)
+        {
+            decayTime = std::max(newDecayTime, SampleType(0.01));
+            updateLines();
+        }
+    }
+
+    // One-pole low-pass in every line, so highs die away faster than lows
+    void setDampingFrequency(SampleType newFrequency)
+    {
+        double cutoff = std::clamp(static_cast<double>(newFrequency), 20.0, sampleRate * 0.49);
+        lowpassCoefficient = static_cast<SampleType>(std::exp(-EngineConstants<double>::twoPi * cutoff / sampleRate));
+    }
+
+    void processSample(SampleType inputLeft, SampleType inputRight, SampleType& outputLeft, SampleType& outputRight)
+    {
+        std::array<SampleType, MAX_LINES> state;
+
+        // Read every line at its modulated position
+        for (int i = 0; i < numLines; ++i)
+        {
+            SampleType newCos = oscillatorCos[i] * rotationCos[i] - oscillatorSin[i] * rotationSin[i];
+            SampleType newSin = oscillatorSin[i] * rotationCos[i] + oscillatorCos[i] * rotationSin[i];
+            oscillatorCos[i] = newCos;
+            oscillatorSin[i] = newSin;
+
+            SampleType delay = delayTimes[i] + MODULATION_DEPTH * (SampleType(1) + newSin);
+            int delayInt = static_cast<int>(delay);
+            SampleType frac = delay - static_cast<SampleType>(delayInt);
+
+            const auto& buffer = buffers[static_cast<size_t>(i)];
+            SampleType newer = buffer[static_cast<size_t>((writePos - delayInt) & bufferMask)];
+            SampleType older = buffer[static_cast<size_t>((writePos - delayInt - 1) & bufferMask)];
+
+            state[i] = newer + frac * (older - newer);
+        }
+
+        // Left from the even lines, right from the odd ones, with alternating
+        // signs so the two outputs stay decorrelated
+        SampleType sumLeft = 0;
+        SampleType sumRight = 0;
+        for (int i = 0; i < numLines; i += 2)
+        {
+            SampleType sign = (i & 2) ? SampleType(-1) : SampleType(1);
+            sumLeft += sign * state[i];
+            sumRight += sign * state[i + 1];
+        }
+
+        outputLeft = sumLeft * outputGain;
+        outputRight = sumRight * outputGain;
+
+        mixHadamard(state);
+
+        // Decay and damping per line, then feed the input back in
+        for (int i = 0; i < numLines; ++i)
+        {
+            SampleType filtered = state[i] + lowpassCoefficient * (lowpassState[i] - state[i]);
+            lowpassState[i] = filtered;
+
+            SampleType input = (i & 1) ? inputRight : inputLeft;
+            buffers[static_cast<size_t>(i)][static_cast<size_t>(writePos)] = filtered * lineGains[i] + input * inputGain;
+        }
+
+        writePos = (writePos + 1) & bufferMask;
+    }
+
+private:
+    void mixHadamard(std::array<SampleType, MAX_LINES>& state) const
+    {
+        for (int half = 1; half < numLines; half <<= 1)
+        {
+            for (int block = 0; block < numLines; block += half << 1)
+            {
+                for (int i = block; i < block + half; ++i)
+                {
+                    SampleType a = state[i];
+                    SampleType b = state[i + half];
+                    state[i] = a + b;
+                    state[i + half] = a - b;
+                }
+            }
+        }
+
+        // Orthonormal, so the decay comes from the line gains alone
+        SampleType normalisation = SampleType(1) / std::sqrt(static_cast<SampleType>(numLines));
+        for (int i = 0; i < numLines; ++i)
+            state[i] *= normalisation;
+    }
+
+    void updateLines()
+    {
+        // Exponentially spaced lengths, kept odd so no two share a period
+        for (int i = 0; i < numLines; ++i)
+        {
+            double position = static_cast<double>(i) / static_cast<double>(numLines - 1);
+            double seconds = MIN_DELAY_TIME * std::pow(MAX_DELAY_TIME / MIN_DELAY_TIME, position);
+            int samples = static_cast<int>(seconds * sampleRate) | 1;
+
+            delayTimes[static_cast<size_t>(i)] = static_cast<SampleType>(samples);
+
+            // -60 dB after decayTime seconds, for this line's round trip
+            double averageDelay = static_cast<double>(samples) + MODULATION_DEPTH;
+            lineGains[static_cast<size_t>(i)] = static_cast<SampleType>(std::pow(10.0, -3.0 * averageDelay / (static_cast<double>(decayTime) * sampleRate)));
+        }
+
+        // Each channel feeds and reads half the lines. The input is spread
+        // over them, which keeps the tail level the same for 8 and 16 lines
+        inputGain = SampleType(1) / std::sqrt(static_cast<SampleType>(numLines / 2));
+        outputGain = SampleType(0.5);
+    }
+
+    static constexpr double MIN_DELAY_TIME = 0.021;         // Seconds, close to the tap cloud's pre-delay
+    static constexpr double MAX_DELAY_TIME = 0.089;         // Seconds
+    static constexpr SampleType MODULATION_DEPTH = SampleType(6);   // Samples either side of the centre
+
+    std::array<std::vector<SampleType>, MAX_LINES> buffers;
+    int bufferSize = 1;
+    int bufferMask = 0;
+    int writePos = 0;
+
+    int numLines = 8;
+    double sampleRate = 44100.0;
+    SampleType decayTime = SampleType(1.5);
+    SampleType inputGain = 0;
+    SampleType outputGain = 0;
+    SampleType lowpassCoefficient = 0;
+
+    std::array<SampleType, MAX_LINES> delayTimes {};
+    std::array<SampleType, MAX_LINES> lineGains {};
+    std::array<SampleType, MAX_LINES> lowpassState {};
+
+    // Quadrature oscillators rotated one step per sample, so no sin() per sample
+    std::array<SampleType, MAX_LINES> oscillatorCos {};
+    std::array<SampleType, MAX_LINES> oscillatorSin {};
+    std::array<SampleType, MAX_LINES> rotationCos {};
+    std::array<SampleType, MAX_LINES> rotationSin {};
+};
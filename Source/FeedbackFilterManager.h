@@ -0,0 +1,234 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include "DspCommon.h"
+#include "DspKernels.h"
+
+// Low-pass/high-pass pair in every line's feedback path, so each repeat
+// comes back a little darker and thinner, like tape. The whole bank runs as
+// one structure of arrays: lane 2 * line + channel, one sample at a time
+// across all lanes, so the inner loop vectorises over lines instead of
+// paying for a separate scalar filter per line and channel.
+template <typename SampleType>
+class FeedbackFilterManager
+{
+public:
+    static constexpr int MAX_LINES = 16;
+
+    // numLines is the most lines the owner will ever pass to process(), so
+    // the cutoff spread reaches its full depth on the last of them
+    void prepare(const EngineSpec& spec, int numLines)
+    {
+        assert(numLines >= 1 && numLines <= MAX_LINES);
+        sampleRate = spec.sampleRate;
+        maxLines = numLines;
+        updateCoefficients();
+        reset();
+    }
+
+    void reset()
+    {
+        lowPassStates.fill(0);
+        highPassStates.fill(0);
+        activeLines = 0;
+    }
+
+    void setLowPassFrequency(SampleType newFrequency)
+    {
+        if (lowPassFrequency != newFrequency)
+        {
+            lowPassFrequency = newFrequency;
+            updateCoefficients();
+        }
+    }
+
+    void setHighPassFrequency(SampleType newFrequency)
+    {
+        if (highPassFrequency != newFrequency)
+        {
+            highPassFrequency = newFrequency;
+            updateCoefficients();
+        }
+    }
+
+    // Lowers the low-pass of each further line, reaching this many octaves
+    // below the base cutoff on the last line
+    void setCutoffSpread(SampleType newOctaves)
+    {
+        if (cutoffSpread != newOctaves)
+        {
+            cutoffSpread = newOctaves;
+            updateCoefficients();
+        }
+    }
+
+    // With both cutoffs at the ends of their ranges the loop is left untouched
+    bool isBypassed() const
+    {
+        return lowPassFrequency >= BYPASS_LOW_PASS && highPassFrequency <= BYPASS_HIGH_PASS && cutoffSpread <= 0;
+    }
+
+    // Filters the feedback blocks of the first numLines lines in place
+    void process(SampleType* const* left, SampleType* const* right, int numLines, int numSamples)
+    {
+        assert(numSamples <= DspKernels::MAX_BLOCK_SIZE);
+
+        if (! beginBlock(numLines))
+            return;
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            for (int n = 0; n < numSamples; ++n)
+            {
+                lanes[static_cast<size_t>(n)][static_cast<size_t>(2 * line)] = left[line][n];
+                lanes[static_cast<size_t>(n)][static_cast<size_t>(2 * line + 1)] = right[line][n];
+            }
+        }
+
+        filterLanes(lowPassStates.data(), highPassStates.data(), lowPassGains.data(), highPassGains.data(),
+                    2 * numLines, numSamples);
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            for (int n = 0; n < numSamples; ++n)
+            {
+                left[line][n] = lanes[static_cast<size_t>(n)][static_cast<size_t>(2 * line)];
+                right[line][n] = lanes[static_cast<size_t>(n)][static_cast<size_t>(2 * line + 1)];
+            }
+        }
+    }
+
+    // For when both sides carry the same signal: only the left blocks are
+    // filtered, and the right lanes' state is kept equal to the left so the
+    // sides can split again at any block
+    void processLinked(SampleType* const* left, int numLines, int numSamples)
+    {
+        assert(numSamples <= DspKernels::MAX_BLOCK_SIZE);
+
+        if (! beginBlock(numLines))
+            return;
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            linkedLowPassStates[static_cast<size_t>(line)] = lowPassStates[static_cast<size_t>(2 * line)];
+            linkedHighPassStates[static_cast<size_t>(line)] = highPassStates[static_cast<size_t>(2 * line)];
+            linkedLowPassGains[static_cast<size_t>(line)] = lowPassGains[static_cast<size_t>(2 * line)];
+            linkedHighPassGains[static_cast<size_t>(line)] = highPassGains[static_cast<size_t>(2 * line)];
+
+            for (int n = 0; n < numSamples; ++n)
+                lanes[static_cast<size_t>(n)][static_cast<size_t>(line)] = left[line][n];
+        }
+
+        filterLanes(linkedLowPassStates.data(), linkedHighPassStates.data(), linkedLowPassGains.data(),
+                    linkedHighPassGains.data(), numLines, numSamples);
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                lowPassStates[static_cast<size_t>(2 * line + channel)] = linkedLowPassStates[static_cast<size_t>(line)];
+                highPassStates[static_cast<size_t>(2 * line + channel)] = linkedHighPassStates[static_cast<size_t>(line)];
+            }
+
+            for (int n = 0; n < numSamples; ++n)
+                left[line][n] = lanes[static_cast<size_t>(n)][static_cast<size_t>(line)];
+        }
+    }
+
+private:
+    // Returns false when the bank is bypassed for this block
+    bool beginBlock(int numLines)
+    {
+        assert(numLines <= MAX_LINES);
+
+        if (isBypassed())
+        {
+            activeLines = 0;
+            return false;
+        }
+
+        // Lines that were not filtered last block start from silence
+        for (int lane = 2 * activeLines; lane < 2 * numLines; ++lane)
+        {
+            lowPassStates[static_cast<size_t>(lane)] = 0;
+            highPassStates[static_cast<size_t>(lane)] = 0;
+        }
+
+        activeLines = numLines;
+        return true;
+    }
+
+    // TPT one-poles over the first numLanes lanes of the transposed block;
+    // the high-pass is the input minus its own low-pass
+    void filterLanes(SampleType* lp, SampleType* hp, const SampleType* lpGain, const SampleType* hpGain,
+                     int numLanes, int numSamples)
+    {
+        for (int n = 0; n < numSamples; ++n)
+        {
+            SampleType* x = lanes[static_cast<size_t>(n)].data();
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                SampleType v = (x[lane] - lp[lane]) * lpGain[lane];
+                SampleType lowPass = v + lp[lane];
+                lp[lane] = lowPass + v;
+
+                SampleType w = (lowPass - hp[lane]) * hpGain[lane];
+                SampleType rumble = w + hp[lane];
+                hp[lane] = rumble + w;
+
+                x[lane] = lowPass - rumble;
+            }
+        }
+    }
+
+    void updateCoefficients()
+    {
+        SampleType highPassGain = getOnePoleGain(static_cast<double>(highPassFrequency));
+
+        for (int line = 0; line < maxLines; ++line)
+        {
+            double octaves = maxLines > 1 ? static_cast<double>(cutoffSpread) * line / (maxLines - 1) : 0.0;
+            SampleType lowPassGain = getOnePoleGain(static_cast<double>(lowPassFrequency) * std::exp2(-octaves));
+
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                lowPassGains[static_cast<size_t>(2 * line + channel)] = lowPassGain;
+                highPassGains[static_cast<size_t>(2 * line + channel)] = highPassGain;
+            }
+        }
+    }
+
+    // G = g / (1 + g) with the prewarped g = tan(pi * fc / fs)
+    SampleType getOnePoleGain(double frequency) const
+    {
+        double cutoff = std::clamp(frequency, 1.0, sampleRate * 0.49);
+        double g = std::tan(EngineConstants<double>::pi * cutoff / sampleRate);
+        return static_cast<SampleType>(g / (1.0 + g));
+    }
+
+    static constexpr SampleType BYPASS_LOW_PASS = SampleType(20000);
+    static constexpr SampleType BYPASS_HIGH_PASS = SampleType(20);
+
+    SampleType lowPassFrequency = BYPASS_LOW_PASS;
+    SampleType highPassFrequency = BYPASS_HIGH_PASS;
+    SampleType cutoffSpread = 0;
+    double sampleRate = 44100.0;
+    int maxLines = MAX_LINES;
+    int activeLines = 0;
+
+    std::array<SampleType, 2 * MAX_LINES> lowPassGains {};
+    std::array<SampleType, 2 * MAX_LINES> highPassGains {};
+    std::array<SampleType, 2 * MAX_LINES> lowPassStates {};
+    std::array<SampleType, 2 * MAX_LINES> highPassStates {};
+
+    // One lane per line while the sides are linked, see processLinked()
+    std::array<SampleType, MAX_LINES> linkedLowPassGains {};
+    std::array<SampleType, MAX_LINES> linkedHighPassGains {};
+    std::array<SampleType, MAX_LINES> linkedLowPassStates {};
+    std::array<SampleType, MAX_LINES> linkedHighPassStates {};
+
+    // The block transposed so that each sample's lanes are contiguous
+    std::array<std::array<SampleType, 2 * MAX_LINES>, DspKernels::MAX_BLOCK_SIZE> lanes {};
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include "DspCommon.h"
+#include "DspKernels.h"
+
+template <typename SampleType>
+class FeedbackMatrixManager
+{
+public:
+    enum class MatrixType
+    {
+        Identity,       // Each line feeds back only into itself
+        PingPong,       // Left lines feed the right lines and vice versa
+        Householder,    // Reflection about the mean, O(N) per channel
+        Hadamard        // Fast Walsh-Hadamard transform, O(N log N) per channel
+    };
+
+    FeedbackMatrixManager()
+    {
+        sum.fill(0);
+        for (auto& row : scratch)
+            row.fill(0);
+    }
+
+    void setType(MatrixType newType)
+    {
+        matrixType = newType;
+    }
+
+    MatrixType getType() const { return matrixType; }
+
+    // Mixes the feedback blocks of the first numLines lines in place.
+    // Every operation runs along whole rows, so it vectorises over time.
+    void process(SampleType* const* left, SampleType* const* right, int numLines, int numSamples)
+    {
+        assert(numLines <= MAX_LINES);
+        assert(numSamples <= DspKernels::MAX_BLOCK_SIZE);
+
+        if (numLines < 2 && matrixType != MatrixType::PingPong)
+            return;
+
+        switch (matrixType)
+        {
+            case MatrixType::Identity:
+                break;
+
+            case MatrixType::PingPong:
+                for (int i = 0; i < numLines; ++i)
+                    std::swap_ranges(left[i], left[i] + numSamples, right[i]);
+                break;
+
+            case MatrixType::Householder:
+                processHouseholder(left, numLines, numSamples);
+                processHouseholder(right, numLines, numSamples);
+                break;
+
+            case MatrixType::Hadamard:
+                processHadamard(left, numLines, numSamples);
+                processHadamard(right, numLines, numSamples);
+                break;
+        }
+    }
+
+    // For when both sides carry the same signal: the matrices act on each
+    // side alone, so only the left blocks are mixed, and ping-pong would
+    // only swap two equal blocks
+    void processLinked(SampleType* const* left, int numLines, int numSamples)
+    {
+        assert(numLines <= MAX_LINES);
+        assert(numSamples <= DspKernels::MAX_BLOCK_SIZE);
+
+        if (matrixType == MatrixType::Householder && numLines >= 2)
+            processHouseholder(left, numLines, numSamples);
+        else if (matrixType == MatrixType::Hadamard && numLines >= 2)
+            processHadamard(left, numLines, numSamples);
+    }
+
+    static constexpr int MAX_LINES = 16;
+
+private:
+    void processHouseholder(SampleType* const* rows, int numLines, int numSamples)
+    {
+        // I - (2/N) * 1 * 1^T is orthogonal, so the loop gain stays at the feedback setting
+        auto& kernels = DspKernels::get<SampleType>();
+
+        std::fill(sum.begin(), sum.begin() + numSamples, SampleType(0));
+        for (int i = 0; i < numLines; ++i)
+            kernels.addWithMultiply(sum.data(), rows[i], SampleType(1), numSamples);
+
+        SampleType reflection = SampleType(-2) / static_cast<SampleType>(numLines);
+        for (int i = 0; i < numLines; ++i)
+            kernels.addWithMultiply(rows[i], sum.data(), reflection, numSamples);
+    }
+
+    void processHadamard(SampleType* const* rows, int numLines, int numSamples)
+    {
+        // Pad to the next power of two; truncating the orthonormal transform
+        // afterwards can only lose energy, so the loop stays stable
+        int size = 1;
+        while (size < numLines)
+            size <<= 1;
+
+        for (int i = 0; i < size; ++i)
+        {
+            if (i < numLines)
+                std::copy(rows[i], rows[i] + numSamples, scratch[i].begin());
+            else
+                std::fill(scratch[i].begin(), scratch[i].begin() + numSamples, SampleType(0));
+        }
+
+        for (int half = 1; half < size; half <<= 1)
+        {
+            for (int block = 0; block < size; block += half << 1)
+            {
+                for (int i = block; i < block + half; ++i)
+                {
+                    SampleType* a = scratch[i].data();
+                    SampleType* b = scratch[i + half].data();
+
+                    for (int n = 0; n < numSamples; ++n)
+                    {
+                        SampleType sumSample = a[n] + b[n];
+                        b[n] = a[n] - b[n];
+                        a[n] = sumSample;
+                    }
+                }
+            }
+        }
+
+        SampleType normalisation = SampleType(1) / std::sqrt(static_cast<SampleType>(size));
+        for (int i = 0; i < numLines; ++i)
+            for (int n = 0; n < numSamples; ++n)
+                rows[i][n] = scratch[i][n] * normalisation;
+    }
+
+    MatrixType matrixType = MatrixType::Identity;
+    std::array<SampleType, DspKernels::MAX_BLOCK_SIZE> sum;
+    std::array<std::array<SampleType, DspKernels::MAX_BLOCK_SIZE>, MAX_LINES> scratch;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <array>
+#include <cassert>
+#include "DspCommon.h"
+#include "DspKernels.h"
+
+// Soft saturation in every line's feedback path, so high feedback settings
+// regenerate into a bounded, compressed wash instead of running away. The
+// curve is a cubic soft clipper with unity slope at zero, run through
+// first-order antiderivative anti-aliasing (ADAA): the output is the mean
+// of the curve between consecutive inputs, which takes out most of the
+// aliasing without oversampling. Drive raises the level going into the curve
+// and lowers it again afterwards, so quiet repeats pass at unity gain and
+// only loud ones get squashed.
+//
+// Like FeedbackFilterManager the bank runs across lanes 2 * line + channel,
+// and the curve and its antiderivative are branch-free polynomials, so the
+// inner loop vectorises over lines.
+template <typename SampleType>
+class FeedbackSaturationManager
+{
+public:
+    static constexpr int MAX_LINES = 16;
+
+    void prepare(const EngineSpec& spec)
+    {
+        smoothedGain.reset(spec.sampleRate, 0.05);
+        smoothedGain.setCurrentAndTargetValue(getGain(drive));
+        reset();
+    }
+
+    void reset()
+    {
+        previousInputs.fill(0);
+        activeLines = 0;
+    }
+
+    // 0 leaves the loop untouched, 1 drives it MAX_GAIN times harder into the curve
+    void setDrive(SampleType newDrive)
+    {
+        drive = std::clamp(newDrive, SampleType(0), SampleType(1));
+        smoothedGain.setTargetValue(getGain(drive));
+    }
+
+    bool isBypassed() const
+    {
+        return drive <= 0 && ! smoothedGain.isSmoothing();
+    }
+
+    // Saturates the feedback blocks of the first numLines lines in place
+    void process(SampleType* const* left, SampleType* const* right, int numLines, int numSamples)
+    {
+        assert(numLines <= MAX_LINES);
+        assert(numSamples <= DspKernels::MAX_BLOCK_SIZE);
+
+        if (isBypassed())
+        {
+            activeLines = 0;
+            return;
+        }
+
+        // Lines that were not saturated last block have no previous input yet
+        for (int line = activeLines; line < numLines; ++line)
+        {
+            previousInputs[static_cast<size_t>(2 * line)] = left[line][0];
+            previousInputs[static_cast<size_t>(2 * line + 1)] = right[line][0];
+        }
+
+        activeLines = numLines;
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            for (int n = 0; n < numSamples; ++n)
+            {
+                lanes[static_cast<size_t>(n)][static_cast<size_t>(2 * line)] = left[line][n];
+                lanes[static_cast<size_t>(n)][static_cast<size_t>(2 * line + 1)] = right[line][n];
+            }
+        }
+
+        saturateLanes(previousInputs.data(), 2 * numLines, numSamples);
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            for (int n = 0; n < numSamples; ++n)
+            {
+                left[line][n] = lanes[static_cast<size_t>(n)][static_cast<size_t>(2 * line)];
+                right[line][n] = lanes[static_cast<size_t>(n)][static_cast<size_t>(2 * line + 1)];
+            }
+        }
+    }
+
+    // For when both sides carry the same signal: only the left blocks are
+    // saturated, and the right lanes' previous inputs follow the left
+    void processLinked(SampleType* const* left, int numLines, int numSamples)
+    {
+        assert(numLines <= MAX_LINES);
+        assert(numSamples <= DspKernels::MAX_BLOCK_SIZE);
+
+        if (isBypassed())
+        {
+            activeLines = 0;
+            return;
+        }
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            linkedPreviousInputs[static_cast<size_t>(line)] = line < activeLines ? previousInputs[static_cast<size_t>(2 * line)]
+                                                                                 : left[line][0];
+
+            for (int n = 0; n < numSamples; ++n)
+                lanes[static_cast<size_t>(n)][static_cast<size_t>(line)] = left[line][n];
+        }
+
+        activeLines = numLines;
+        saturateLanes(linkedPreviousInputs.data(), numLines, numSamples);
+
+        for (int line = 0; line < numLines; ++line)
+        {
+            previousInputs[static_cast<size_t>(2 * line)] = linkedPreviousInputs[static_cast<size_t>(line)];
+            previousInputs[static_cast<size_t>(2 * line + 1)] = linkedPreviousInputs[static_cast<size_t>(line)];
+
+            for (int n = 0; n < numSamples; ++n)
+                left[line][n] = lanes[static_cast<size_t>(n)][static_cast<size_t>(line)];
+        }
+    }
+
+private:
+    // Runs the first numLanes lanes of the transposed block through the curve
+    void saturateLanes(SampleType* previous, int numLanes, int numSamples)
+    {
+        // The gain moves once per block; within it the curve stays fixed so
+        // the previous input keeps meaning the same thing
+        SampleType gain = smoothedGain.skip(numSamples);
+        SampleType inverseGain = SampleType(1) / gain;
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            SampleType* x = lanes[static_cast<size_t>(n)].data();
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                SampleType u = x[lane] * gain;
+                SampleType uPrevious = previous[lane] * gain;
+                SampleType difference = u - uPrevious;
+
+                // Where the two inputs are too close to divide by their
+                // difference, the curve at their midpoint is the same mean
+                bool isClose = std::abs(difference) < ILL_CONDITIONED;
+                SampleType safeDifference = isClose ? SampleType(1) : difference;
+                SampleType mean = (antiderivative(u) - antiderivative(uPrevious)) / safeDifference;
+                SampleType midpoint = curve(SampleType(0.5) * (u + uPrevious));
+
+                previous[lane] = x[lane];
+                x[lane] = (isClose ? midpoint : mean) * inverseGain;
+            }
+        }
+    }
+
+    // u - u^3 / 6.75, flat at +-1 beyond |u| = 1.5
+    static SampleType curve(SampleType u)
+    {
+        SampleType clamped = std::clamp(u, -KNEE, KNEE);
+        return clamped - clamped * clamped * clamped * CUBIC;
+    }
+
+    // Integral of curve(): u^2 / 2 - u^4 / 27 inside the knee, linear beyond it
+    static SampleType antiderivative(SampleType u)
+    {
+        SampleType clamped = std::clamp(u, -KNEE, KNEE);
+        SampleType squared = clamped * clamped;
+        SampleType inside = squared * SampleType(0.5) - squared * squared * QUARTIC;
+        return inside + (std::abs(u) - std::abs(clamped));
+    }
+
+    static SampleType getGain(SampleType newDrive)
+    {
+        return SampleType(1) + newDrive * (MAX_GAIN - SampleType(1));
+    }
+
+    static constexpr SampleType KNEE = SampleType(1.5);
+    static constexpr SampleType CUBIC = SampleType(1.0 / 6.75);
+    static constexpr SampleType QUARTIC = SampleType(1.0 / 27.0);
+    static constexpr SampleType MAX_GAIN = SampleType(8);
+    static constexpr SampleType ILL_CONDITIONED = SampleType(1.0e-4);
+
+    SampleType drive = 0;
+    LinearSmoothedValue<SampleType> smoothedGain { SampleType(1) };
+    int activeLines = 0;
+
+    std::array<SampleType, 2 * MAX_LINES> previousInputs {};
+    std::array<SampleType, MAX_LINES> linkedPreviousInputs {};  // One lane per line, see processLinked()
+
+    // The block transposed so that each sample's lanes are contiguous
+    std::array<std::array<SampleType, 2 * MAX_LINES>, DspKernels::MAX_BLOCK_SIZE> lanes {};
+};
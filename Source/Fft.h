@@ -0,0 +1,77 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+#include "DspCommon.h"
+
+// In-place radix-2 complex FFT. Tables are built in prepare(), so
+// perform() never allocates. The inverse is unscaled, like juce::dsp::FFT
+// without normalisation: a forward and inverse pass multiplies by size.
+template <typename SampleType>
+class Fft
+{
+public:
+    using Complex = std::complex<SampleType>;
+
+    void prepare(int newOrder)
+    {
+        order = newOrder;
+        size = 1 << order;
+
+        twiddles.resize(static_cast<size_t>(size / 2));
+        for (int i = 0; i < size / 2; ++i)
+        {
+            double angle = -2.0 * EngineConstants<double>::pi * i / size;
+            twiddles[static_cast<size_t>(i)] = Complex(static_cast<SampleType>(std::cos(angle)),
+                                                       static_cast<SampleType>(std::sin(angle)));
+        }
+
+        bitReversed.resize(static_cast<size_t>(size));
+        for (int i = 0; i < size; ++i)
+        {
+            int reversed = 0;
+            for (int bit = 0; bit < order; ++bit)
+                if (i & (1 << bit))
+                    reversed |= 1 << (order - 1 - bit);
+
+            bitReversed[static_cast<size_t>(i)] = reversed;
+        }
+    }
+
+    int getSize() const { return size; }
+
+    void perform(Complex* data, bool inverse) const
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            int j = bitReversed[static_cast<size_t>(i)];
+            if (i < j)
+                std::swap(data[i], data[j]);
+        }
+
+        for (int half = 1; half < size; half <<= 1)
+        {
+            int twiddleStep = size / (half << 1);
+
+            for (int block = 0; block < size; block += half << 1)
+            {
+                for (int i = 0; i < half; ++i)
+                {
+                    Complex twiddle = twiddles[static_cast<size_t>(i * twiddleStep)];
+                    if (inverse)
+                        twiddle = std::conj(twiddle);
+
+                    Complex odd = data[block + i + half] * twiddle;
+                    data[block + i + half] = data[block + i] - odd;
+                    data[block + i] += odd;
+                }
+            }
+        }
+    }
+
+private:
+    int order = 0;
+    int size = 1;
+    std::vector<Complex> twiddles;
+    std::vector<int> bitReversed;
+};
@@ -1,37 +1,155 @@
 #pragma once
 
-#include <JuceHeader.h>
+#include <array>
+#include "DspCommon.h"
+#include "DspKernels.h"
 
+// The wet bus's high-pass and low-pass as one cascade of state variable
+// stages, run by a single kernel call per block: the high-pass stages first,
+// then the low-pass stages. Cutoff changes are smoothed, and within a block
+// the coefficients are interpolated per sample between the exact values at
+// its two ends, so automation neither steps nor needs a full recalculation
+// per sample.
+template <typename SampleType>
 class FilterManager
 {
 public:
-    enum class FilterType
+    static constexpr int MAX_SLOPE = DspKernels::MAX_SVF_STAGES / 2;
+
+    FilterManager()
+    {
+        updateStages();
+    }
+
+    void prepare(const EngineSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+
+        for (auto* smoothed : { &smoothedHighPass, &smoothedLowPass })
+        {
+            smoothed->reset(sampleRate, 0.05);
+            smoothed->setCurrentAndTargetValue(smoothed->getTargetValue());
+        }
+
+        reset();
+        updateStages();
+    }
+
+    void reset()
     {
-        LowPass,
-        HighPass
-    };
+        states.fill(DspKernels::SvfState<SampleType>());
+    }
 
-    FilterManager();
+    void setHighPassFrequency(SampleType newFrequency)
+    {
+        smoothedHighPass.setTargetValue(newFrequency);
+    }
 
-    void prepare(const juce::dsp::ProcessSpec& spec);
-    void reset();
+    void setLowPassFrequency(SampleType newFrequency)
+    {
+        smoothedLowPass.setTargetValue(newFrequency);
+    }
+
+    // Slope of both filters in 12 dB/octave steps: 1 to MAX_SLOPE
+    void setSlope(SampleType newSlope)
+    {
+        if (slope != newSlope)
+        {
+            slope = newSlope;
+            updateStages();
+        }
+    }
+
+    void setQ(SampleType newQ)
+    {
+        if (q != newQ)
+        {
+            q = newQ;
+            updateStages();
+        }
+    }
+
+    void processBlock(SampleType* left, SampleType* right, int numSamples)
+    {
+        // Only the two cutoffs move between blocks, so only g and h are recomputed
+        if (smoothedHighPass.isSmoothing() || smoothedLowPass.isSmoothing())
+        {
+            SampleType highPassG = getG(smoothedHighPass.skip(numSamples));
+            SampleType lowPassG = getG(smoothedLowPass.skip(numSamples));
 
-    void setType(FilterType newType);
-    void setFrequency(float newFrequency);
-    void setSlope(float newSlope);
-    void setQ(float newQ);
+            for (int stage = 0; stage < 2 * stagesPerFilter; ++stage)
+                setG(targetCoefficients[static_cast<size_t>(stage)], stage < stagesPerFilter ? highPassG : lowPassG);
+        }
 
-    void processStereoSample(float& leftSample, float& rightSample);
+        DspKernels::get<SampleType>().processSvfStereo(states.data(), currentCoefficients.data(), targetCoefficients.data(),
+                                                       2 * stagesPerFilter, left, right, numSamples);
+
+        currentCoefficients = targetCoefficients;
+    }
 
 private:
-    FilterType currentType;
-    float frequency;
-    float slope;
-    float q;
-    double sampleRate;
+    // Rebuilds the cascade layout and jumps straight to the current cutoffs
+    void updateStages()
+    {
+        int newStagesPerFilter = std::clamp(static_cast<int>(std::lround(slope)), 1, MAX_SLOPE);
+
+        if (newStagesPerFilter != stagesPerFilter)
+        {
+            // Stages that join the cascade start from silence
+            reset();
+            stagesPerFilter = newStagesPerFilter;
+        }
+
+        SampleType highPassG = getG(smoothedHighPass.getCurrentValue());
+        SampleType lowPassG = getG(smoothedLowPass.getCurrentValue());
+
+        for (int stage = 0; stage < 2 * stagesPerFilter; ++stage)
+        {
+            auto& c = targetCoefficients[static_cast<size_t>(stage)];
+            bool isHighPass = stage < stagesPerFilter;
+            int pair = stage % stagesPerFilter;
+
+            c.lowPassMix = isHighPass ? SampleType(0) : SampleType(1);
+            c.highPassMix = isHighPass ? SampleType(1) : SampleType(0);
+            c.bandPassMix = 0;
+
+            // Butterworth pole pairs of each filter; q then shapes the most
+            // resonant pair, which for a single stage is plain q
+            double butterworthQ = 1.0 / (2.0 * std::cos(EngineConstants<double>::pi * (2 * pair + 1) / (4.0 * stagesPerFilter)));
+            double stageQ = pair == stagesPerFilter - 1 ? butterworthQ * static_cast<double>(q) / BUTTERWORTH_Q : butterworthQ;
+
+            c.r2 = static_cast<SampleType>(1.0 / stageQ);
+            setG(c, isHighPass ? highPassG : lowPassG);
+        }
+
+        currentCoefficients = targetCoefficients;
+    }
+
+    SampleType getG(SampleType frequency) const
+    {
+        double cutoff = std::clamp(static_cast<double>(frequency), 1.0, sampleRate * 0.49);
+        return static_cast<SampleType>(std::tan(EngineConstants<double>::pi * cutoff / sampleRate));
+    }
+
+    static void setG(DspKernels::SvfCoefficients<SampleType>& c, SampleType g)
+    {
+        c.g = g;
+        c.h = SampleType(1) / (SampleType(1) + c.r2 * g + g * g);
+    }
+
+    static constexpr double BUTTERWORTH_Q = 0.70710678118654752;
 
-    juce::dsp::StateVariableTPTFilter<float> filterLeft;
-    juce::dsp::StateVariableTPTFilter<float> filterRight;
+    LinearSmoothedValue<SampleType> smoothedHighPass { SampleType(20) };
+    LinearSmoothedValue<SampleType> smoothedLowPass { SampleType(20000) };
+    SampleType slope = SampleType(1);
+    SampleType q = SampleType(0.707);
+    double sampleRate = 44100.0;
+    int stagesPerFilter = 0;
 
-    void updateFilters();
+    // Same topology as juce::dsp::StateVariableTPTFilter, with left and right
+    // held together so the kernel can run them as two lanes
+    using Coefficients = std::array<DspKernels::SvfCoefficients<SampleType>, DspKernels::MAX_SVF_STAGES>;
+    std::array<DspKernels::SvfState<SampleType>, DspKernels::MAX_SVF_STAGES> states {};
+    Coefficients currentCoefficients {};
+    Coefficients targetCoefficients {};
 };
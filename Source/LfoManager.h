@@ -1,36 +1,89 @@
 #pragma once
 
-#include <JuceHeader.h>
 #include <array>
+#include "DspCommon.h"
 
+template <typename SampleType>
 class LFOManager
 {
 public:
-    LFOManager();
-    
-    void prepare(const juce::dsp::ProcessSpec& spec);
-    void reset();
-    
-    void setRate(float rateHz);
-    void setDepth(float depthMs);
-    
-    float getNextSample();
-
-    void calculateAndSetRate(int index);
+    LFOManager() = default;
+
+    void prepare(const EngineSpec& spec)
+    {
+        sampleRate = spec.sampleRate;
+        reset();
+    }
+
+    void reset()
+    {
+        phase = 0;
+        lastSample = 0;
+    }
+
+    void setRate(SampleType rateHz)
+    {
+        frequency = std::max(SampleType(0.01), rateHz); // Ensure rate is always positive
+    }
+
+    void setDepth(SampleType depthMs)
+    {
+        depth = getMaximumOffsetSeconds(depthMs);
+    }
+
+    // The largest value getNextSample() returns for a given depth setting
+    static constexpr SampleType getMaximumOffsetSeconds(SampleType depthMs)
+    {
+        return (depthMs * SampleType(4)) / SampleType(1000); // Convert ms to seconds
+    }
+
+    SampleType getNextSample()
+    {
+        constexpr auto pi = EngineConstants<SampleType>::pi;
+        constexpr auto twoPi = EngineConstants<SampleType>::twoPi;
+
+        SampleType sineComponent = std::sin(phase);
+        SampleType triangleComponent = SampleType(1) - std::abs(phase / pi - SampleType(1));
+
+        // Mix sine and triangle for asymmetry
+        SampleType asymmetricalWave = SampleType(0.9) * sineComponent + SampleType(0.1) * triangleComponent;
+
+        // Apply low-pass filter for "lag" (simple one-pole filter)
+        asymmetricalWave = SampleType(0.99) * lastSample + SampleType(0.01) * asymmetricalWave;
+        lastSample = asymmetricalWave;
+
+        phase += twoPi * frequency / static_cast<SampleType>(sampleRate);
+        if (phase >= twoPi)
+            phase -= twoPi;
+
+        // Scale and offset the wave to the 0-1 range, then apply depth
+        return ((asymmetricalWave * SampleType(0.5) + SampleType(0.5)) * depth);
+    }
+
+    void calculateAndSetRate(int index)
+    {
+        if (index >= 0 && index < NUM_PRESET_FREQUENCIES)
+        {
+            setRate(presetFrequencies[static_cast<size_t>(index)]);
+        }
+        else
+        {
+            // Fallback to a default rate if the index is out of bounds
+            setRate(SampleType(15));
+        }
+    }
 
     static constexpr int NUM_PRESET_FREQUENCIES = 20;
 
 private:
-    static const std::array<float, NUM_PRESET_FREQUENCIES> presetFrequencies;
-
-    juce::dsp::Oscillator<float> lfo;
-    float depth;
-    double sampleRate;
-    float phase;
-    float frequency;
-    float lastSample;
-    
-    float mapToFrequencyRange(float input) const;
-    
-    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LFOManager)
+    static constexpr std::array<SampleType, NUM_PRESET_FREQUENCIES> presetFrequencies = {
+        SampleType(125.0), SampleType(150.0), SampleType(60.0), SampleType(25.0), SampleType(200.0),
+        SampleType(100.0), SampleType(0.90), SampleType(110.0), SampleType(45.5), SampleType(275.0)
+    };
+
+    SampleType depth = 0;
+    double sampleRate = 44100.0;
+    SampleType phase = 0;
+    SampleType frequency = 1;
+    SampleType lastSample = 0;
 };
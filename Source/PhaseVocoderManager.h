@@ -0,0 +1,236 @@
+#pragma once
+
+#include <array>
+#include <complex>
+#include <vector>
+#include "DspCommon.h"
+#include "Fft.h"
+
+// STFT phase-vocoder pitch shifter with 4x overlap-add. Bins are moved to
+// their shifted positions and their phases are re-accumulated from the
+// measured bin frequencies, so sustained material keeps its shape where the
+// time-domain shifter smears. Left and right are packed into the real and
+// imaginary parts of one complex transform, so each hop costs one forward
+// and one inverse FFT for both channels.
+template <typename SampleType>
+class PhaseVocoderManager
+{
+public:
+    using Complex = std::complex<SampleType>;
+
+    void prepare(const EngineSpec& spec)
+    {
+        // Keep the frame near 40-50 ms whatever the sample rate
+        int order = spec.sampleRate <= 48000.0 ? 11 : (spec.sampleRate <= 96000.0 ? 12 : 13);
+
+        fft.prepare(order);
+        frameSize = fft.getSize();
+        hopSize = frameSize / OVERSAMPLING;
+        numBins = frameSize / 2 + 1;
+
+        window.resize(static_cast<size_t>(frameSize));
+        for (int i = 0; i < frameSize; ++i)
+            window[static_cast<size_t>(i)] = static_cast<SampleType>(0.5 - 0.5 * std::cos(2.0 * EngineConstants<double>::pi * i / frameSize));
+
+        workspace.resize(static_cast<size_t>(frameSize));
+
+        for (auto& channel : channels)
+        {
+            channel.inputFifo.resize(static_cast<size_t>(frameSize));
+            channel.outputFifo.resize(static_cast<size_t>(frameSize));
+            channel.outputAccumulator.resize(static_cast<size_t>(frameSize));
+            channel.spectrum.resize(static_cast<size_t>(numBins));
+            channel.lastPhase.resize(static_cast<size_t>(numBins));
+            channel.sumPhase.resize(static_cast<size_t>(numBins));
+            channel.analysisMagnitude.resize(static_cast<size_t>(numBins));
+            channel.analysisFrequency.resize(static_cast<size_t>(numBins));
+            channel.synthesisMagnitude.resize(static_cast<size_t>(numBins));
+            channel.synthesisFrequency.resize(static_cast<size_t>(numBins));
+        }
+
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& channel : channels)
+        {
+            std::fill(channel.inputFifo.begin(), channel.inputFifo.end(), SampleType(0));
+            std::fill(channel.outputFifo.begin(), channel.outputFifo.end(), SampleType(0));
+            std::fill(channel.outputAccumulator.begin(), channel.outputAccumulator.end(), SampleType(0));
+            std::fill(channel.lastPhase.begin(), channel.lastPhase.end(), SampleType(0));
+            std::fill(channel.sumPhase.begin(), channel.sumPhase.end(), SampleType(0));
+        }
+
+        fifoPos = getLatencySamples();
+    }
+
+    void setShiftFactor(SampleType newShiftFactor)
+    {
+        shiftFactor = std::clamp(newShiftFactor, SampleType(0.5), SampleType(2));
+    }
+
+    // Delay between a sample going in and its shifted version coming out
+    int getLatencySamples() const { return frameSize - hopSize; }
+
+    void processBlock(SampleType* left, SampleType* right, int numSamples)
+    {
+        int latency = getLatencySamples();
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto& leftChannel = channels[0];
+            auto& rightChannel = channels[1];
+
+            leftChannel.inputFifo[static_cast<size_t>(fifoPos)] = left[i];
+            rightChannel.inputFifo[static_cast<size_t>(fifoPos)] = right[i];
+            left[i] = leftChannel.outputFifo[static_cast<size_t>(fifoPos - latency)];
+            right[i] = rightChannel.outputFifo[static_cast<size_t>(fifoPos - latency)];
+
+            if (++fifoPos >= frameSize)
+            {
+                fifoPos = latency;
+                processFrame();
+            }
+        }
+    }
+
+private:
+    struct ChannelState
+    {
+        std::vector<SampleType> inputFifo;
+        std::vector<SampleType> outputFifo;
+        std::vector<SampleType> outputAccumulator;
+        std::vector<Complex> spectrum;
+        std::vector<SampleType> lastPhase;
+        std::vector<SampleType> sumPhase;
+        std::vector<SampleType> analysisMagnitude;
+        std::vector<SampleType> analysisFrequency;     // In bins
+        std::vector<SampleType> synthesisMagnitude;
+        std::vector<SampleType> synthesisFrequency;
+    };
+
+    void processFrame()
+    {
+        auto& left = channels[0];
+        auto& right = channels[1];
+
+        for (int i = 0; i < frameSize; ++i)
+            workspace[static_cast<size_t>(i)] = Complex(left.inputFifo[static_cast<size_t>(i)], right.inputFifo[static_cast<size_t>(i)])
+                                              * window[static_cast<size_t>(i)];
+
+        fft.perform(workspace.data(), false);
+
+        // Separate the two real spectra from the packed transform
+        for (int k = 0; k < numBins; ++k)
+        {
+            Complex z = workspace[static_cast<size_t>(k)];
+            Complex mirror = std::conj(workspace[static_cast<size_t>((frameSize - k) & (frameSize - 1))]);
+
+            left.spectrum[static_cast<size_t>(k)] = (z + mirror) * SampleType(0.5);
+            right.spectrum[static_cast<size_t>(k)] = (z - mirror) * Complex(0, SampleType(-0.5));
+        }
+
+        for (auto& channel : channels)
+            shiftSpectrum(channel);
+
+        // Pack both shifted spectra back into one Hermitian pair
+        for (int k = 0; k < numBins; ++k)
+        {
+            Complex l = left.spectrum[static_cast<size_t>(k)];
+            Complex r = right.spectrum[static_cast<size_t>(k)];
+
+            workspace[static_cast<size_t>(k)] = l + Complex(0, 1) * r;
+
+            if (k > 0 && k < numBins - 1)
+                workspace[static_cast<size_t>(frameSize - k)] = std::conj(l) + Complex(0, 1) * std::conj(r);
+        }
+
+        fft.perform(workspace.data(), true);
+
+        // Hann analysis and synthesis windows at 4x overlap sum to 1.5
+        SampleType outputScale = SampleType(1) / (static_cast<SampleType>(frameSize) * SampleType(1.5));
+
+        for (int i = 0; i < frameSize; ++i)
+        {
+            SampleType gain = window[static_cast<size_t>(i)] * outputScale;
+            left.outputAccumulator[static_cast<size_t>(i)] += workspace[static_cast<size_t>(i)].real() * gain;
+            right.outputAccumulator[static_cast<size_t>(i)] += workspace[static_cast<size_t>(i)].imag() * gain;
+        }
+
+        for (auto& channel : channels)
+        {
+            std::copy(channel.outputAccumulator.begin(), channel.outputAccumulator.begin() + hopSize, channel.outputFifo.begin());
+            std::copy(channel.outputAccumulator.begin() + hopSize, channel.outputAccumulator.end(), channel.outputAccumulator.begin());
+            std::fill(channel.outputAccumulator.end() - hopSize, channel.outputAccumulator.end(), SampleType(0));
+
+            std::copy(channel.inputFifo.begin() + hopSize, channel.inputFifo.end(), channel.inputFifo.begin());
+        }
+    }
+
+    void shiftSpectrum(ChannelState& channel)
+    {
+        constexpr auto pi = EngineConstants<SampleType>::pi;
+        constexpr auto twoPi = EngineConstants<SampleType>::twoPi;
+
+        // Phase advance of bin k over one hop is k times this
+        const SampleType expectedAdvance = twoPi / static_cast<SampleType>(OVERSAMPLING);
+
+        // Analysis: measure each bin's true frequency from its phase advance
+        for (int k = 0; k < numBins; ++k)
+        {
+            Complex value = channel.spectrum[static_cast<size_t>(k)];
+            SampleType phase = std::arg(value);
+
+            SampleType deviation = phase - channel.lastPhase[static_cast<size_t>(k)] - static_cast<SampleType>(k) * expectedAdvance;
+            channel.lastPhase[static_cast<size_t>(k)] = phase;
+
+            deviation -= twoPi * std::round(deviation / twoPi);
+
+            channel.analysisMagnitude[static_cast<size_t>(k)] = std::abs(value);
+            channel.analysisFrequency[static_cast<size_t>(k)] = static_cast<SampleType>(k) + deviation / expectedAdvance;
+        }
+
+        // Move every bin to its shifted position
+        std::fill(channel.synthesisMagnitude.begin(), channel.synthesisMagnitude.end(), SampleType(0));
+        std::fill(channel.synthesisFrequency.begin(), channel.synthesisFrequency.end(), SampleType(0));
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            int target = static_cast<int>(std::lround(static_cast<SampleType>(k) * shiftFactor));
+            if (target >= numBins)
+                break;
+
+            channel.synthesisMagnitude[static_cast<size_t>(target)] += channel.analysisMagnitude[static_cast<size_t>(k)];
+            channel.synthesisFrequency[static_cast<size_t>(target)] = channel.analysisFrequency[static_cast<size_t>(k)] * shiftFactor;
+        }
+
+        // Synthesis: accumulate phase at the shifted frequencies
+        for (int k = 0; k < numBins; ++k)
+        {
+            SampleType& sumPhase = channel.sumPhase[static_cast<size_t>(k)];
+            sumPhase += channel.synthesisFrequency[static_cast<size_t>(k)] * expectedAdvance;
+            sumPhase -= twoPi * std::floor((sumPhase + pi) / twoPi);
+
+            channel.spectrum[static_cast<size_t>(k)] = std::polar(channel.synthesisMagnitude[static_cast<size_t>(k)], sumPhase);
+        }
+
+        // A real signal's DC and Nyquist bins are real. Any imaginary part the
+        // shift leaves there would land in the other channel once both are packed
+        for (int k : { 0, numBins - 1 })
+            channel.spectrum[static_cast<size_t>(k)].imag(SampleType(0));
+    }
+
+    static constexpr int OVERSAMPLING = 4;
+
+    Fft<SampleType> fft;
+    int frameSize = 2048;
+    int hopSize = 512;
+    int numBins = 1025;
+    int fifoPos = 0;
+    SampleType shiftFactor = 1;
+
+    std::vector<SampleType> window;
+    std::vector<Complex> workspace;
+    std::array<ChannelState, 2> channels;
+};
@@ -1,29 +1,247 @@
 #pragma once
-#include <JuceHeader.h>
 
+#include <array>
+#include <random>
+#include <vector>
+#include "DspCommon.h"
+#include "DspKernels.h"
+
+// Delay-modulation pitch shifter: two read heads sweep through a short
+// window at the shift rate, half a window apart, and each one fades out
+// with a Hann window just before it jumps back to the other end. The two
+// windows always sum to one, so the jumps are never heard.
+// Each channel has its own buffer; the heads and windows are shared, so
+// both channels are shifted identically and the stereo image holds.
+template <typename SampleType>
 class PitchShifterManager
 {
 public:
-    PitchShifterManager();
+    PitchShifterManager()
+    {
+        // Half a Hann period, plus a guard entry for the interpolation
+        for (int i = 0; i <= WINDOW_TABLE_SIZE; ++i)
+        {
+            SampleType phase = EngineConstants<SampleType>::pi * static_cast<SampleType>(i) / WINDOW_TABLE_SIZE;
+            windowTable[static_cast<size_t>(i)] = std::sin(phase) * std::sin(phase);
+        }
+
+        // Seed RNG with a unique value
+        std::random_device rd;
+        rng.seed(rd());
+    }
+
+    void prepare(const EngineSpec& spec)
+    {
+        sampleRate = static_cast<SampleType>(spec.sampleRate);
+        windowSamples = crossfadeDuration * sampleRate;
+
+        // Room for the whole window behind the oldest write of a block
+        int requiredSize = static_cast<int>(std::ceil(windowSamples)) + MIN_DELAY + 4 + DspKernels::MAX_BLOCK_SIZE;
+
+        bufferSize = 1;
+        while (bufferSize < requiredSize)
+            bufferSize <<= 1;
+
+        bufferMask = bufferSize - 1;
+        for (auto& buffer : buffers)
+            buffer.assign(static_cast<size_t>(bufferSize), SampleType(0));
+
+        reset();
+        calculateCrossfadeIncrement();
+    }
+
+    void reset()
+    {
+        writePos = 0;
+        crossfadePos = 0;
+        quietSamples = 0;
+        for (auto& buffer : buffers)
+            std::fill(buffer.begin(), buffer.end(), SampleType(0));
+    }
+
+    // Longest a sample stays in the window before it has been read out
+    SampleType getWindowSeconds() const { return crossfadeDuration; }
+
+    void setShiftFactor(SampleType newShiftFactor)
+    {
+        shiftFactor = std::clamp(newShiftFactor, SampleType(0.5), SampleType(2));
+        calculateCrossfadeIncrement();
+    }
+
+    void setNoiseAmplitude(SampleType amplitude)
+    {
+        noiseAmplitude = std::clamp(amplitude, SampleType(0), SampleType(0.001)); // Ensure amplitude is within a reasonable range
+    }
+
+    // Shifts both channels in place; numSamples may not exceed DspKernels::MAX_BLOCK_SIZE
+    void processBlock(SampleType* left, SampleType* right, int numSamples)
+    {
+        SampleType* channels[NUM_CHANNELS] = { left, right };
+
+        // Write the whole block first, so every head can interpolate forwards
+        SampleType inputPeak = 0;
+        for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+        {
+            for (int i = 0; i < numSamples; ++i)
+            {
+                buffers[channel][static_cast<size_t>((writePos + i) & bufferMask)] = channels[channel][i];
+                inputPeak = std::max(inputPeak, std::abs(channels[channel][i]));
+            }
+        }
+
+        SampleType noiseGain = getNoiseGain(inputPeak, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            SampleType otherPos = crossfadePos + SampleType(0.5);
+            if (otherPos >= SampleType(1))
+                otherPos -= SampleType(1);
+
+            SampleType writeIndex = static_cast<SampleType>(writePos + i);
+            SampleType gain = getWindow(crossfadePos);
+            SampleType otherGain = getWindow(otherPos);
+
+            for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+            {
+                const auto& buffer = buffers[channel];
+                SampleType out = readHead(buffer, writeIndex, crossfadePos) * gain
+                               + readHead(buffer, writeIndex, otherPos) * otherGain;
+
+                // Add controlled noise to the output sample
+                channels[channel][i] = out + generateNoise() * noiseGain;
+            }
+
+            // Move both heads through the window; the delay grows when shifting
+            // down and shrinks when shifting up, wrapping at either end
+            crossfadePos += crossfadeIncrement;
+            if (crossfadePos >= SampleType(1))
+                crossfadePos -= SampleType(1);
+            else if (crossfadePos < SampleType(0))
+                crossfadePos += SampleType(1);
+        }
+
+        writePos = (writePos + numSamples) & bufferMask;
+    }
+
+    // Same as processBlock() for two channels that carry the same signal: the
+    // heads are read once and only the noise is drawn per channel
+    void processBlockLinked(SampleType* left, SampleType* right, int numSamples)
+    {
+        SampleType inputPeak = 0;
+        for (int i = 0; i < numSamples; ++i)
+            inputPeak = std::max(inputPeak, std::abs(left[i]));
 
-    void prepare(const juce::dsp::ProcessSpec& spec);
-    void reset();
-    void setShiftFactor(float newShiftFactor);
-    void setNoiseAmplitude(float amplitude); // Adjust noise amplitude
-    void process(float& sample);
+        for (int channel = 0; channel < NUM_CHANNELS; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                buffers[channel][static_cast<size_t>((writePos + i) & bufferMask)] = left[i];
+
+        SampleType noiseGain = getNoiseGain(inputPeak, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            SampleType otherPos = crossfadePos + SampleType(0.5);
+            if (otherPos >= SampleType(1))
+                otherPos -= SampleType(1);
+
+            SampleType writeIndex = static_cast<SampleType>(writePos + i);
+            SampleType out = readHead(buffers[0], writeIndex, crossfadePos) * getWindow(crossfadePos)
+                           + readHead(buffers[0], writeIndex, otherPos) * getWindow(otherPos);
+
+            left[i] = out + generateNoise() * noiseGain;
+            right[i] = out + generateNoise() * noiseGain;
+
+            crossfadePos += crossfadeIncrement;
+            if (crossfadePos >= SampleType(1))
+                crossfadePos -= SampleType(1);
+            else if (crossfadePos < SampleType(0))
+                crossfadePos += SampleType(1);
+        }
+
+        writePos = (writePos + numSamples) & bufferMask;
+    }
 
 private:
-    juce::AudioBuffer<float> buffer;
-    int writePos;
-    float readPos;
-    float shiftFactor;
-    int bufferSize;
-    float crossfadePos;
-    float crossfadeDuration;
-    float sampleRate;
-    float crossfadeIncrement;
-    float noiseAmplitude; // Amplitude of the noise
-
-    void calculateCrossfadeIncrement();
-    float generateNoise() const; // Generate controlled noise
+    SampleType readHead(const std::vector<SampleType>& buffer, SampleType writeIndex, SampleType windowPos) const
+    {
+        // The newest neighbour used by the interpolation is never ahead of the write
+        SampleType readPos = writeIndex - static_cast<SampleType>(MIN_DELAY) - windowPos * windowSamples;
+        SampleType readFloor = std::floor(readPos);
+        SampleType frac = readPos - readFloor;
+        int index = static_cast<int>(readFloor) + bufferSize;
+
+        return cubicInterpolate(buffer[static_cast<size_t>((index - 1) & bufferMask)],
+                                buffer[static_cast<size_t>(index & bufferMask)],
+                                buffer[static_cast<size_t>((index + 1) & bufferMask)],
+                                buffer[static_cast<size_t>((index + 2) & bufferMask)], frac);
+    }
+
+    SampleType getWindow(SampleType windowPos) const
+    {
+        SampleType tablePos = windowPos * WINDOW_TABLE_SIZE;
+        int index = std::min(static_cast<int>(tablePos), WINDOW_TABLE_SIZE - 1);
+        SampleType frac = tablePos - static_cast<SampleType>(index);
+
+        return windowTable[static_cast<size_t>(index)]
+             + frac * (windowTable[static_cast<size_t>(index) + 1] - windowTable[static_cast<size_t>(index)]);
+    }
+
+    static SampleType cubicInterpolate(SampleType p0, SampleType p1, SampleType p2, SampleType p3, SampleType t)
+    {
+        SampleType a = (-p0 / SampleType(2)) + (SampleType(3) * p1 / SampleType(2)) - (SampleType(3) * p2 / SampleType(2)) + (p3 / SampleType(2));
+        SampleType b = p0 - (SampleType(5) * p1 / SampleType(2)) + (SampleType(2) * p2) - (p3 / SampleType(2));
+        SampleType c = (-p0 / SampleType(2)) + (p2 / SampleType(2));
+        SampleType d = p1;
+
+        return a * t * t * t + b * t * t + c * t + d;
+    }
+
+    // Window phase advance per sample for the current shift factor
+    void calculateCrossfadeIncrement()
+    {
+        crossfadeIncrement = (SampleType(1) - shiftFactor) / (crossfadeDuration * sampleRate);
+    }
+
+    // The noise only accompanies signal: once the input has stayed below the
+    // noise level for a whole window, every head reads silence and so does
+    // the output, instead of a constant hiss the engine could never sleep through
+    SampleType getNoiseGain(SampleType inputPeak, int numSamples)
+    {
+        if (inputPeak >= noiseAmplitude)
+            quietSamples = 0;
+        else
+            quietSamples = std::min(quietSamples + numSamples, bufferSize);
+
+        bool hasDrained = static_cast<SampleType>(quietSamples) > windowSamples + static_cast<SampleType>(MIN_DELAY + 4);
+        return hasDrained ? SampleType(0) : noiseAmplitude;
+    }
+
+    // Generate controlled noise
+    SampleType generateNoise()
+    {
+        return noiseDistribution(rng); // [-1, 1] range
+    }
+
+    static constexpr int MIN_DELAY = 2;             // Keeps the cubic neighbours behind the write head
+    static constexpr int WINDOW_TABLE_SIZE = 1024;
+    static constexpr int NUM_CHANNELS = 2;
+
+    std::array<std::vector<SampleType>, NUM_CHANNELS> buffers;
+    int bufferSize = 1;
+    int bufferMask = 0;
+    int writePos = 0;
+    int quietSamples = 0;           // Samples the input has stayed below the noise level
+    SampleType shiftFactor = 1;
+
+    // Position of the first head within the window, 0 to 1
+    SampleType crossfadePos = 0;
+    SampleType crossfadeDuration = SampleType(0.04); // Window length in seconds
+    SampleType crossfadeIncrement = 0;
+    SampleType windowSamples = 0;
+    SampleType sampleRate = SampleType(44100);
+    SampleType noiseAmplitude = SampleType(0.0005); // Ensure a very low amplitude
+
+    std::array<SampleType, WINDOW_TABLE_SIZE + 1> windowTable {};
+
+    std::minstd_rand rng;
+    std::uniform_real_distribution<SampleType> noiseDistribution { SampleType(-1), SampleType(1) };
 };
@@ -34,30 +34,19 @@ QuantadelayAudioProcessor::QuantadelayAudioProcessor()
     lowPassFreqParameter = parameters.getRawParameterValue("lowPassFreq");
     highPassFreqParameter = parameters.getRawParameterValue("highPassFreq");
     dampParameter = parameters.getRawParameterValue("damp");
-
-    
-    highPassFilter.reset();
-    lowPassFilter.reset();
-    StereoFieldManager().reset();
-    PitchShifterManager().reset();
-
-    for (int i = 0; i < MAX_DELAY_LINES; ++i)
-    {
-        delayManagersLeft[i].reset();
-        delayManagersRight[i].reset();
-        lfoManagersLeft[i].reset();
-        lfoManagersRight[i].reset();
-    }
-
-    highPassFilter.setType(FilterManager::FilterType::HighPass);
-    highPassFilter.setFrequency(500.0f);  // 500 Hz
-    highPassFilter.setQ(0.707f);  // Butterworth response
-    highPassFilter.setSlope(1.0f);  // 12 dB/octave
-
-    lowPassFilter.setType(FilterManager::FilterType::LowPass);
-    lowPassFilter.setFrequency(2000.0f);  // 2000 Hz
-    lowPassFilter.setQ(0.707f);  // Butterworth response
-    lowPassFilter.setSlope(1.0f);  // 12 dB/octave
+    delayModeParameter = parameters.getRawParameterValue("delayMode");
+    feedbackMatrixParameter = parameters.getRawParameterValue("feedbackMatrix");
+    pitchModeParameter = parameters.getRawParameterValue("pitchMode");
+    pitchRoutingParameter = parameters.getRawParameterValue("pitchRouting");
+    dampModeParameter = parameters.getRawParameterValue("dampMode");
+    diffusionParameter = parameters.getRawParameterValue("diffusion");
+    filterSlopeParameter = parameters.getRawParameterValue("filterSlope");
+    loopLowPassFreqParameter = parameters.getRawParameterValue("loopLowPassFreq");
+    loopHighPassFreqParameter = parameters.getRawParameterValue("loopHighPassFreq");
+    loopFilterSpreadParameter = parameters.getRawParameterValue("loopFilterSpread");
+    linePanParameter = parameters.getRawParameterValue("linePan");
+    wetRateParameter = parameters.getRawParameterValue("wetRate");
+    driveParameter = parameters.getRawParameterValue("drive");
 }
 
 QuantadelayAudioProcessor::~QuantadelayAudioProcessor()
@@ -106,6 +95,58 @@ juce::AudioProcessorValueTreeState::ParameterLayout QuantadelayAudioProcessor::c
         juce::ParameterID("damp", 6), "damp",
         juce::NormalisableRange<float>(0.0f, 20.0f), 0.0f));
     
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("delayMode", 10), "Delay Mode",
+        juce::StringArray { "Glide", "Crossfade" }, 0));
+    
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("feedbackMatrix", 11), "Feedback Matrix",
+        juce::StringArray { "Identity", "Ping-Pong", "Householder", "Hadamard" }, 0));
+    
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("pitchMode", 12), "Pitch Mode",
+        juce::StringArray { "Time Domain", "Phase Vocoder" }, 0));
+    
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("pitchRouting", 13), "Pitch Routing",
+        juce::StringArray { "Post", "Shimmer" }, 0));
+    
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("dampMode", 14), "Damp Mode",
+        juce::StringArray { "Tap Cloud", "FDN 8", "FDN 16", "Convolution" }, 0));
+    
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID("diffusion", 15), "Diffusion",
+        juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f));
+    
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("filterSlope", 16), "Filter Slope",
+        juce::StringArray { "12 dB/oct", "24 dB/oct", "36 dB/oct", "48 dB/oct" }, 0));
+    
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID("loopLowPassFreq", 17), "Loop Low Pass Freq",
+        juce::NormalisableRange<float>(250.0f, 20000.0f, 1.0f, 0.3f), 20000.0f));
+    
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID("loopHighPassFreq", 18), "Loop High Pass Freq",
+        juce::NormalisableRange<float>(20.0f, 2000.0f, 1.0f, 0.3f), 20.0f));
+    
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID("loopFilterSpread", 19), "Loop Filter Spread",
+        juce::NormalisableRange<float>(0.0f, 3.0f), 0.0f));
+    
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID("linePan", 20), "Line Pan",
+        juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f));
+    
+    params.push_back(std::make_unique<juce::AudioParameterChoice>(
+        juce::ParameterID("wetRate", 21), "Wet Rate",
+        juce::StringArray { "Full", "Half", "Quarter" }, 0));
+    
+    params.push_back(std::make_unique<juce::AudioParameterFloat>(
+        juce::ParameterID("drive", 22), "Drive",
+        juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f));
+    
     
     return { params.begin(), params.end() };
 }
@@ -145,7 +186,10 @@ bool QuantadelayAudioProcessor::isMidiEffect() const
 
 double QuantadelayAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    if (isUsingDoublePrecision())
+        return doubleEngine.getTailLengthSeconds(getEngineParameters<DoubleEngine>());
+
+    return engine.getTailLengthSeconds(getEngineParameters<Engine>());
 }
 
 int QuantadelayAudioProcessor::getNumPrograms()
@@ -175,64 +219,71 @@ void QuantadelayAudioProcessor::changeProgramName (int index, const juce::String
 //==============================================================================
 void QuantadelayAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    juce::dsp::ProcessSpec spec;
+    EngineSpec spec;
     spec.sampleRate = sampleRate;
-    spec.maximumBlockSize = static_cast<juce::uint32> (samplesPerBlock);
+    spec.maximumBlockSize = samplesPerBlock;
     spec.numChannels = getTotalNumOutputChannels();
-    
-    highPassFilter.prepare(spec);
-    lowPassFilter.prepare(spec);
-    
-    dampManager.prepare(spec);
 
-    float initialDelayTime = *delayTimeParameter;
+    // Only the engine for the host's precision is prepared, so the other one
+    // never allocates its buffers
+    if (isUsingDoublePrecision())
+        prepareEngine(doubleEngine, spec);
+    else
+        prepareEngine(engine, spec);
+}
 
-    for (int i = 0; i < MAX_DELAY_LINES; ++i)
-    {
-        lfoManagersLeft[i].reset();
-        lfoManagersRight[i].reset();
-        
-        float currentDelayTime = initialDelayTime * std::pow(0.66f, i);
-        delayManagersLeft[i].prepare(spec, currentDelayTime);
-        delayManagersRight[i].prepare(spec, currentDelayTime);
-//        stereoManagers[i].prepare(spec);
-
-//        stereoManagers[i].calculateAndSetPosition(i, MAX_DELAY_LINES);
-        
-        lfoManagersLeft[i].prepare(spec);
-        lfoManagersRight[i].prepare(spec);
-        lfoManagersLeft[i].setDepth(1.0f);
-        lfoManagersRight[i].setDepth(1.0f);
-        
-        lfoManagersLeft[i].calculateAndSetRate(i);
-        lfoManagersRight[i].calculateAndSetRate(i);
-    }
-    
-    for (auto& pitchShifter : pitchShifterManagers)
-    {
-        pitchShifter.prepare(spec);
-    }
+template <typename EngineType>
+void QuantadelayAudioProcessor::prepareEngine(EngineType& engineToPrepare, const EngineSpec& spec)
+{
+    std::vector<typename EngineType::ChannelRole> roles;
+    auto layout = getChannelLayoutOfBus(false, 0);
+    for (int channel = 0; channel < layout.size(); ++channel)
+        roles.push_back(getChannelRole<EngineType>(layout.getTypeOfChannel(channel)));
 
-    smoothedDelayLines.reset(sampleRate, 0.05);
-    smoothedDelayLines.setCurrentAndTargetValue(1.0f);
+    engineToPrepare.setChannelRoles(roles);
+    engineToPrepare.setParameters(getEngineParameters<EngineType>());
+    engineToPrepare.prepare(spec);
+
+    setLatencySamples(engineToPrepare.getLatencySamples());
 }
 
-void QuantadelayAudioProcessor::releaseResources()
+template <typename EngineType>
+typename EngineType::ChannelRole QuantadelayAudioProcessor::getChannelRole(juce::AudioChannelSet::ChannelType type)
 {
-    StereoFieldManager().reset();
-    PitchShifterManager().reset();
-    highPassFilter.reset();
-    lowPassFilter.reset();
+    using Set = juce::AudioChannelSet;
+    using Role = typename EngineType::ChannelRole;
 
-    for (int i = 0; i < MAX_DELAY_LINES; ++i)
+    switch (type)
     {
-        delayManagersLeft[i].reset();
-        delayManagersRight[i].reset();
-        lfoManagersLeft[i].reset();
-        lfoManagersRight[i].reset();
+        case Set::left: case Set::leftSurround: case Set::leftCentre: case Set::leftSurroundSide:
+        case Set::leftSurroundRear: case Set::wideLeft: case Set::topFrontLeft: case Set::topRearLeft:
+            return Role::Left;
+
+        case Set::right: case Set::rightSurround: case Set::rightCentre: case Set::rightSurroundSide:
+        case Set::rightSurroundRear: case Set::wideRight: case Set::topFrontRight: case Set::topRearRight:
+            return Role::Right;
+
+        case Set::LFE: case Set::LFE2:
+            return Role::Mute;
+
+        default:
+            return Role::Centre;
     }
 }
 
+void QuantadelayAudioProcessor::handleAsyncUpdate()
+{
+    suspendProcessing(true);
+    prepareToPlay(getSampleRate(), getBlockSize());
+    suspendProcessing(false);
+}
+
+void QuantadelayAudioProcessor::releaseResources()
+{
+    engine.reset();
+    doubleEngine.reset();
+}
+
 #ifndef JucePlugin_PreferredChannelConfigurations
 bool QuantadelayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 {
@@ -240,12 +291,10 @@ bool QuantadelayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Anything from mono up to a 7.1 bed; the engine folds it into its
+    // stereo wet path, see QuantaEngine::setChannelRoles()
+    auto numChannels = layouts.getMainOutputChannelSet().size();
+    if (numChannels < 1 || numChannels > Engine::MAX_CHANNELS)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -260,116 +309,81 @@ bool QuantadelayAudioProcessor::isBusesLayoutSupported (const BusesLayout& layou
 #endif
 
 void QuantadelayAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processWithEngine(engine, buffer);
+}
+
+void QuantadelayAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processWithEngine(doubleEngine, buffer);
+}
+
+bool QuantadelayAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename EngineType, typename SampleType>
+void QuantadelayAudioProcessor::processWithEngine(EngineType& engineToUse, juce::AudioBuffer<SampleType>& buffer)
 {
     juce::ScopedNoDenormals noDenormals;
     
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
     
-    float mixValue = mixParameter->load();
-    float delayTimeValue = delayTimeParameter->load();
-    float feedbackValue = feedbackParameter->load();
-    float depthValue = depthParameter->load();
-    float spreadValue = spreadParameter->load();
-    float octavesValue = octavesParameter->load();
-    float lowPassFreq = lowPassFreqParameter->load();
-    float highPassFreq = highPassFreqParameter->load();
-    float dampValue = dampParameter->load();
-
-    dampManager.setDamp(dampValue);
-
-    lowPassFilter.setFrequency(lowPassFreq);
-    highPassFilter.setFrequency(highPassFreq);
-
-
-    int targetDelayLines = static_cast<int>(std::round(delayLinesParameter->load()));
-    targetDelayLines = juce::jlimit(1, MAX_DELAY_LINES, targetDelayLines);
-
-    smoothedDelayLines.setTargetValue(static_cast<float>(targetDelayLines));
-    
-    auto* leftChannel = buffer.getWritePointer(0);
-    auto* rightChannel = buffer.getWritePointer(1);
-
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    // Update parameters for all delay lines
-    for (int i = 0; i < MAX_DELAY_LINES; ++i)
-    {
-        float normalizedPosition = static_cast<float>(i) / static_cast<float>(MAX_DELAY_LINES - 1);
-        lfoManagersLeft[i].calculateAndSetRate(i);
-        lfoManagersRight[i].calculateAndSetRate(i);
-        
-        lfoManagersLeft[i].setDepth(depthValue);
-        lfoManagersRight[i].setDepth(depthValue);
-        
-        float lfoValueLeft = lfoManagersLeft[i].getNextSample();
-        float lfoValueRight = lfoManagersRight[i].getNextSample();
-        float currentDelayTimeLeft = delayTimeValue * std::pow(spreadValue, i) + lfoValueLeft;
-        float currentDelayTimeRight = delayTimeValue * std::pow(spreadValue, i) + lfoValueRight;
-
-        delayManagersLeft[i].setDelayTime(currentDelayTimeLeft);
-        delayManagersRight[i].setDelayTime(currentDelayTimeRight);
-        delayManagersLeft[i].setFeedback(feedbackValue);
-        delayManagersRight[i].setFeedback(feedbackValue);
-
-        if (i == 0) {
-            // First delay line remains unshifted
-            pitchShifterManagers[i].setShiftFactor(1.0f);
-        } else if (i % 4 == 1) {
-            // Every 4th line (1, 5, 9, ...) is shifted up an octave
-            pitchShifterManagers[i].setShiftFactor(2.0f);
-        } else if (i % 2 == 1) {
-            // Other odd lines (3, 7, 11, ...) are shifted down an octave
-            pitchShifterManagers[i].setShiftFactor(0.5f);
-        } else {
-            // Even lines (2, 4, 6, 8, ...) are unshifted
-            pitchShifterManagers[i].setShiftFactor(1.0f);
-        }
-    }
+    engineToUse.setParameters(getEngineParameters<EngineType>());
 
+    // A new wet rate resizes every buffer, which has to happen off the audio thread
+    if (engineToUse.isPrepareNeeded())
+        triggerAsyncUpdate();
 
-    for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-    {
-        float inputSampleLeft = leftChannel[sample];
-        float inputSampleRight = rightChannel[sample];
-        float wetSignalLeft = 0.0f;
-        float wetSignalRight = 0.0f;
-
-        float currentDelayLines = smoothedDelayLines.getNextValue();
-        int fullDelayLines = static_cast<int>(std::floor(currentDelayLines));
-
-        for (int i = 0; i < fullDelayLines; ++i)
-        {
-            float delayedSampleLeft = delayManagersLeft[i].processSample(inputSampleLeft);
-            float delayedSampleRight = delayManagersRight[i].processSample(inputSampleRight);
-            
-            float leftOutput = delayedSampleLeft;
-            float rightOutput = delayedSampleRight;
-            
-            if (i < octavesValue && i < fullDelayLines + 1) {
-                pitchShifterManagers[i].process(leftOutput);
-                pitchShifterManagers[i].process(rightOutput);
-            }
-
-//            stereoManagers[i].process(leftOutput, rightOutput);
-            
-            wetSignalLeft += leftOutput;
-            wetSignalRight += rightOutput;
-        }
-
-//         Scale the wet signal by the current (smoothed) number of delay lines
-        wetSignalLeft /= currentDelayLines;
-        wetSignalRight /= currentDelayLines;
-        
-        dampManager.process(wetSignalLeft, wetSignalRight);
-        
-        highPassFilter.processStereoSample(wetSignalLeft, wetSignalRight);
-        lowPassFilter.processStereoSample(wetSignalLeft, wetSignalRight);
-
-        leftChannel[sample] = inputSampleLeft + mixValue * (wetSignalLeft);
-        rightChannel[sample] = inputSampleRight + mixValue * (wetSignalRight);
-    }
+    engineToUse.process(buffer.getArrayOfWritePointers(), totalNumOutputChannels, buffer.getNumSamples());
+
+    // The pitch mode decides the latency, so follow it when it is switched
+    if (engineToUse.getLatencySamples() != getLatencySamples())
+        setLatencySamples(engineToUse.getLatencySamples());
+}
+
+template <typename EngineType>
+typename EngineType::Parameters QuantadelayAudioProcessor::getEngineParameters() const
+{
+    using Engine = EngineType;
+
+    typename Engine::Parameters engineParameters;
+
+    engineParameters.mix = mixParameter->load();
+    engineParameters.delayTime = delayTimeParameter->load();
+    engineParameters.feedback = feedbackParameter->load();
+    engineParameters.delayLines = static_cast<int>(std::round(delayLinesParameter->load()));
+    engineParameters.depth = depthParameter->load();
+    engineParameters.spread = spreadParameter->load();
+    engineParameters.octaves = octavesParameter->load();
+    engineParameters.lowPassFreq = lowPassFreqParameter->load();
+    engineParameters.highPassFreq = highPassFreqParameter->load();
+    engineParameters.damp = dampParameter->load();
+    engineParameters.delayMode = delayModeParameter->load() >= 0.5f ? Engine::DelayTimeMode::Crossfade
+                                                                     : Engine::DelayTimeMode::Glide;
+    engineParameters.feedbackMatrix = static_cast<typename Engine::MatrixType>(
+        juce::roundToInt(feedbackMatrixParameter->load()));
+    engineParameters.pitchMode = pitchModeParameter->load() >= 0.5f ? Engine::PitchMode::PhaseVocoder
+                                                                     : Engine::PitchMode::TimeDomain;
+    engineParameters.pitchRouting = pitchRoutingParameter->load() >= 0.5f ? Engine::PitchRouting::Shimmer
+                                                                           : Engine::PitchRouting::Post;
+    engineParameters.dampMode = static_cast<typename Engine::DampMode>(
+        juce::roundToInt(dampModeParameter->load()));
+    engineParameters.diffusion = diffusionParameter->load();
+    engineParameters.filterSlope = juce::roundToInt(filterSlopeParameter->load()) + 1;
+    engineParameters.loopLowPassFreq = loopLowPassFreqParameter->load();
+    engineParameters.loopHighPassFreq = loopHighPassFreqParameter->load();
+    engineParameters.loopFilterSpread = loopFilterSpreadParameter->load();
+    engineParameters.linePan = linePanParameter->load();
+    engineParameters.wetRate = 1 << juce::roundToInt(wetRateParameter->load());
+    engineParameters.drive = driveParameter->load();
+
+    return engineParameters;
 }
 
 //==============================================================================
@@ -11,20 +11,15 @@
 #include <JuceHeader.h>
 #include <juce_dsp/juce_dsp.h>
 #include <juce_audio_processors/juce_audio_processors.h>
-#include "DelayManager.h"
-#include "StereoFieldManager.h"
-#include "LFOManager.h"
-#include "PitchShifterManager.h"
-#include "FilterManager.h"
-#include "DampManager.h"
+#include "QuantaEngine.h"
 
 #define MAX_DELAY_TIME 2
-#define MAX_DELAY_LINES 10
 
 //==============================================================================
 /**
 */
-class QuantadelayAudioProcessor  : public juce::AudioProcessor
+class QuantadelayAudioProcessor  : public juce::AudioProcessor,
+                                   private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -40,6 +35,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -78,22 +75,43 @@ private:
     std::atomic<float>* lowPassFreqParameter = nullptr;
     std::atomic<float>* highPassFreqParameter = nullptr;
     std::atomic<float>* dampParameter = nullptr;
-
-    
-    std::array<StereoFieldManager, MAX_DELAY_LINES> stereoManagers;
-    std::array<DelayManager, MAX_DELAY_LINES> delayManagersLeft;
-    std::array<DelayManager, MAX_DELAY_LINES> delayManagersRight;
-    std::array<LFOManager, MAX_DELAY_LINES> lfoManagersLeft;
-    std::array<LFOManager, MAX_DELAY_LINES> lfoManagersRight;
-    std::array<PitchShifterManager, MAX_DELAY_LINES> pitchShifterManagers;
-    
-    DampManager dampManager;
-    
-    FilterManager highPassFilter;
-    FilterManager lowPassFilter;
-
-    juce::SmoothedValue<float> smoothedDelayLines;
-    int previousDelayLinesValue = 1;
+    std::atomic<float>* delayModeParameter = nullptr;
+    std::atomic<float>* feedbackMatrixParameter = nullptr;
+    std::atomic<float>* pitchModeParameter = nullptr;
+    std::atomic<float>* pitchRoutingParameter = nullptr;
+    std::atomic<float>* dampModeParameter = nullptr;
+    std::atomic<float>* diffusionParameter = nullptr;
+    std::atomic<float>* filterSlopeParameter = nullptr;
+    std::atomic<float>* loopLowPassFreqParameter = nullptr;
+    std::atomic<float>* loopHighPassFreqParameter = nullptr;
+    std::atomic<float>* loopFilterSpreadParameter = nullptr;
+    std::atomic<float>* linePanParameter = nullptr;
+    std::atomic<float>* wetRateParameter = nullptr;
+    std::atomic<float>* driveParameter = nullptr;
+
+    static constexpr int maxDelayLines = 10;
+
+    using Engine = QuantaEngine<float, maxDelayLines>;
+    using DoubleEngine = QuantaEngine<double, maxDelayLines>;
+
+    template <typename EngineType>
+    typename EngineType::Parameters getEngineParameters() const;
+
+    template <typename EngineType>
+    static typename EngineType::ChannelRole getChannelRole(juce::AudioChannelSet::ChannelType type);
+
+    template <typename EngineType>
+    void prepareEngine(EngineType& engineToPrepare, const EngineSpec& spec);
+
+    template <typename EngineType, typename SampleType>
+    void processWithEngine(EngineType& engineToUse, juce::AudioBuffer<SampleType>& buffer);
+
+    // Re-prepares the engine for parameters it can only take in prepare()
+    void handleAsyncUpdate() override;
+
+    // One engine per host precision, see prepareToPlay()
+    Engine engine;
+    DoubleEngine doubleEngine;
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QuantadelayAudioProcessor)
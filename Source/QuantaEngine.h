@@ -0,0 +1,902 @@
+#pragma once
+
+#include <array>
+#include <limits>
+#include <vector>
+#include "DspCommon.h"
+#include "DspKernels.h"
+#include "DelayManager.h"
+#include "StereoFieldManager.h"
+#include "LfoManager.h"
+#include "PitchShifterManager.h"
+#include "PhaseVocoderManager.h"
+#include "FilterManager.h"
+#include "DampManager.h"
+#include "DiffusionManager.h"
+#include "FeedbackMatrixManager.h"
+#include "FeedbackFilterManager.h"
+#include "FeedbackSaturationManager.h"
+#include "RateConverterManager.h"
+
+// The complete delay engine, free of any JUCE types so it can be built and
+// run outside the plugin. The processor only converts parameters and buffers.
+template <typename SampleType, int MaxLines>
+class QuantaEngine
+{
+public:
+    using DelayTimeMode = typename DelayManager<SampleType>::DelayTimeMode;
+    using MatrixType = typename FeedbackMatrixManager<SampleType>::MatrixType;
+    using DampMode = typename DampManager<SampleType>::DampMode;
+
+    static_assert(MaxLines > 1 && MaxLines <= FeedbackMatrixManager<SampleType>::MAX_LINES,
+                  "The feedback matrix supports at most MAX_LINES lines");
+    static_assert(MaxLines <= FeedbackFilterManager<SampleType>::MAX_LINES,
+                  "The feedback filters support at most MAX_LINES lines");
+    static_assert(MaxLines <= FeedbackSaturationManager<SampleType>::MAX_LINES,
+                  "The feedback saturation supports at most MAX_LINES lines");
+
+    static constexpr int MAX_LINES = MaxLines;
+    static constexpr int MAX_CHANNELS = 8;  // Up to a 7.1 bed
+
+    // How a bus channel feeds the stereo wet path and takes its return
+    enum class ChannelRole
+    {
+        Left,
+        Right,
+        Centre,     // Feeds and takes both sides equally
+        Mute        // Passes dry only, e.g. an LFE channel
+    };
+
+    enum class PitchMode
+    {
+        TimeDomain,     // Two-head delay modulation, no latency
+        PhaseVocoder    // STFT phase vocoder, adds getLatencySamples() to the whole output
+    };
+
+    enum class PitchRouting
+    {
+        Post,           // Lines are shifted on their way to the output only
+        Shimmer         // Each line is shifted before its feedback, so shifts build up per repeat
+    };
+
+    struct Parameters
+    {
+        SampleType mix = SampleType(0.5);
+        SampleType delayTime = SampleType(0.5);         // Seconds
+        SampleType feedback = SampleType(0.5);
+        int delayLines = 1;
+        SampleType depth = SampleType(0.5);             // Milliseconds
+        SampleType spread = SampleType(0.875);
+        SampleType octaves = SampleType(1);
+        SampleType lowPassFreq = SampleType(20000);
+        SampleType highPassFreq = SampleType(20);
+        SampleType damp = 0;
+        DelayTimeMode delayMode = DelayTimeMode::Glide; // Crossfade ignores depth
+        MatrixType feedbackMatrix = MatrixType::Identity;
+        PitchMode pitchMode = PitchMode::TimeDomain;
+        PitchRouting pitchRouting = PitchRouting::Post;
+        DampMode dampMode = DampMode::TapCloud;
+        SampleType diffusion = 0;                       // Allpass wash before the damp stage, 0 to 1
+        int filterSlope = 1;                            // Output filters, in 12 dB/octave steps
+        SampleType loopLowPassFreq = SampleType(20000); // Inside every feedback path
+        SampleType loopHighPassFreq = SampleType(20);
+        SampleType loopFilterSpread = 0;                // Octaves the last line's low-pass sits below the first
+        SampleType linePan = 0;                         // Width of the per-line pan pattern, 0 to 1
+        SampleType drive = 0;                           // Saturation in every feedback path, 0 to 1
+        int wetRate = 1;                                // Wet path runs at 1/wetRate of the host rate: 1, 2 or 4. Applied by prepare()
+    };
+
+    QuantaEngine()
+    {
+        outputFilter.setHighPassFrequency(SampleType(500));  // 500 Hz
+        outputFilter.setLowPassFrequency(SampleType(2000));  // 2000 Hz
+        outputFilter.setQ(SampleType(0.707));  // Butterworth response
+        outputFilter.setSlope(SampleType(1));  // 12 dB/octave
+
+        setLineShiftFactors(getDefaultShiftFactors());
+        setChannelRoles({ ChannelRole::Left, ChannelRole::Right });
+    }
+
+    // Sets the role of every bus channel; channels past the list pass dry.
+    // Each side of the wet input is the average of the channels feeding it,
+    // so a mono bus feeds both sides the same signal.
+    void setChannelRoles(const std::vector<ChannelRole>& roles)
+    {
+        std::array<ChannelRole, MAX_CHANNELS> channelRoles {};
+        int leftCount = 0, rightCount = 0;
+        channelRoles.fill(ChannelRole::Mute);
+
+        for (size_t channel = 0; channel < std::min(roles.size(), static_cast<size_t>(MAX_CHANNELS)); ++channel)
+        {
+            channelRoles[channel] = roles[channel];
+            leftCount += roles[channel] == ChannelRole::Left || roles[channel] == ChannelRole::Centre ? 1 : 0;
+            rightCount += roles[channel] == ChannelRole::Right || roles[channel] == ChannelRole::Centre ? 1 : 0;
+        }
+
+        for (size_t channel = 0; channel < MAX_CHANNELS; ++channel)
+        {
+            ChannelRole role = channelRoles[channel];
+            bool toLeft = role == ChannelRole::Left || role == ChannelRole::Centre;
+            bool toRight = role == ChannelRole::Right || role == ChannelRole::Centre;
+
+            sendGainsLeft[channel] = toLeft ? SampleType(1) / static_cast<SampleType>(leftCount) : SampleType(0);
+            sendGainsRight[channel] = toRight ? SampleType(1) / static_cast<SampleType>(rightCount) : SampleType(0);
+            returnGainsLeft[channel] = toLeft ? (toRight ? SampleType(0.5) : SampleType(1)) : SampleType(0);
+            returnGainsRight[channel] = toRight ? (toLeft ? SampleType(0.5) : SampleType(1)) : SampleType(0);
+        }
+
+        // A plain left/right pair, or a single channel feeding both sides, is
+        // read in place; anything else is folded down into scratch first
+        isPlainStereo = roles.size() == 2 && roles[0] == ChannelRole::Left && roles[1] == ChannelRole::Right;
+        isPlainMono = roles.size() == 1 && roles[0] == ChannelRole::Centre;
+    }
+
+    // Line 0 and the even lines are unshifted, lines 1, 5, 9, ... go up an
+    // octave and the remaining odd lines go down an octave
+    static constexpr std::array<SampleType, MaxLines> getDefaultShiftFactors()
+    {
+        std::array<SampleType, MaxLines> factors {};
+
+        for (int i = 0; i < MaxLines; ++i)
+        {
+            if (i % 4 == 1)
+                factors[static_cast<size_t>(i)] = SampleType(2);
+            else if (i % 2 == 1)
+                factors[static_cast<size_t>(i)] = SampleType(0.5);
+            else
+                factors[static_cast<size_t>(i)] = SampleType(1);
+        }
+
+        return factors;
+    }
+
+    // Sets the interval of every line as a shift factor. Lines that share a
+    // factor are summed and shifted together, since the shifter is linear
+    // and all lines in a group would follow the same head trajectory.
+    void setLineShiftFactors(const std::array<SampleType, MaxLines>& newFactors)
+    {
+        lineShiftFactors = newFactors;
+        numShiftGroups = 0;
+
+        for (int i = 0; i < MaxLines; ++i)
+        {
+            SampleType factor = lineShiftFactors[static_cast<size_t>(i)];
+            lineShiftGroups[static_cast<size_t>(i)] = -1;
+            shimmerShifters[static_cast<size_t>(i)].setShiftFactor(factor);
+
+            // Unity lines skip the shifter entirely
+            if (factor == SampleType(1))
+                continue;
+
+            int group = 0;
+            while (group < numShiftGroups && shiftGroupFactors[static_cast<size_t>(group)] != factor)
+                ++group;
+
+            if (group == numShiftGroups)
+            {
+                shiftGroupFactors[static_cast<size_t>(group)] = factor;
+                pitchShifterManagers[static_cast<size_t>(group)].setShiftFactor(factor);
+                phaseVocoders[static_cast<size_t>(group)].setShiftFactor(factor);
+                ++numShiftGroups;
+            }
+
+            lineShiftGroups[static_cast<size_t>(i)] = group;
+        }
+    }
+
+    // Uses the delay time and wet rate from the last setParameters() call
+    void prepare(const EngineSpec& hostSpec)
+    {
+        hostSampleRate = hostSpec.sampleRate;
+        quietSamples = 0;
+        rateConverter.prepare(getWetRateFactor());
+
+        // Everything after the dry split runs at the wet rate
+        EngineSpec spec = hostSpec;
+        spec.sampleRate = hostSpec.sampleRate / rateConverter.getFactor();
+        spec.maximumBlockSize = DspKernels::MAX_BLOCK_SIZE;
+
+        outputFilter.prepare(spec);
+
+        feedbackFilter.prepare(spec, MaxLines);
+        feedbackSaturation.prepare(spec);
+        diffusionManager.prepare(spec);
+        dampManager.prepare(spec);
+
+        for (int i = 0; i < MaxLines; ++i)
+        {
+            lfoManagersLeft[i].reset();
+            lfoManagersRight[i].reset();
+
+            SampleType currentDelayTime = parameters.delayTime * std::pow(SampleType(0.66), static_cast<SampleType>(i));
+            delayManagersLeft[i].prepare(spec, currentDelayTime);
+            delayManagersRight[i].prepare(spec, currentDelayTime);
+
+            lfoManagersLeft[i].prepare(spec);
+            lfoManagersRight[i].prepare(spec);
+            lfoManagersLeft[i].setDepth(SampleType(1));
+            lfoManagersRight[i].setDepth(SampleType(1));
+
+            lfoManagersLeft[i].calculateAndSetRate(i);
+            lfoManagersRight[i].calculateAndSetRate(i);
+        }
+
+        for (auto& pitchShifter : pitchShifterManagers)
+        {
+            pitchShifter.prepare(spec);
+        }
+
+        for (auto& phaseVocoder : phaseVocoders)
+        {
+            phaseVocoder.prepare(spec);
+        }
+
+        // Noise injected inside the loop would build up with the feedback
+        for (auto& shimmerShifter : shimmerShifters)
+        {
+            shimmerShifter.prepare(spec);
+            shimmerShifter.setNoiseAmplitude(SampleType(0));
+        }
+
+        // Everything that bypasses the vocoder is delayed to match it
+        int vocoderLatency = phaseVocoders[0].getLatencySamples();
+        for (auto& compensation : dryCompensation)
+            compensation.prepare(vocoderLatency * rateConverter.getFactor());
+        wetCompensationLeft.prepare(vocoderLatency);
+        wetCompensationRight.prepare(vocoderLatency);
+
+        activePitchMode = parameters.pitchMode;
+        activePitchRouting = parameters.pitchRouting;
+        updateLatencyCompensation();
+
+        smoothedDelayLines.reset(spec.sampleRate, 0.05);
+        smoothedDelayLines.setCurrentAndTargetValue(SampleType(1));
+
+        for (auto& linePanner : linePanners)
+            linePanner.prepare(spec);
+
+        smoothedLinePan.reset(spec.sampleRate, 0.05);
+        smoothedLinePan.setCurrentAndTargetValue(parameters.linePan);
+        panLineCount = std::clamp(parameters.delayLines, 1, MaxLines);
+        updateLinePanGains(parameters.linePan);
+
+        channelsLinked = true;
+    }
+
+    void reset()
+    {
+        rateConverter.reset();
+        outputFilter.reset();
+        diffusionManager.reset();
+        dampManager.reset();
+        feedbackFilter.reset();
+        feedbackSaturation.reset();
+
+        for (int i = 0; i < MaxLines; ++i)
+        {
+            delayManagersLeft[i].reset();
+            delayManagersRight[i].reset();
+            lfoManagersLeft[i].reset();
+            lfoManagersRight[i].reset();
+        }
+
+        // Every path is empty again, so both channels can share their work
+        updateLatencyCompensation();
+        channelsLinked = true;
+        quietSamples = 0;
+        isAsleep = false;
+        sleepClearStep = NUM_SLEEP_CLEAR_STEPS;
+    }
+
+    void setParameters(const Parameters& newParameters)
+    {
+        parameters = newParameters;
+    }
+
+    const Parameters& getParameters() const { return parameters; }
+
+    // True when the parameters ask for something only prepare() can apply
+    bool isPrepareNeeded() const
+    {
+        return getWetRateFactor() != rateConverter.getFactor();
+    }
+
+    // How long the output keeps sounding after the input stops, until the
+    // repeats are 60 dB down and the stages after the lines have drained.
+    // Infinite at full feedback, where the loop never decays. Takes the
+    // parameters explicitly so it can be asked from any thread.
+    double getTailLengthSeconds(const Parameters& tailParameters) const
+    {
+        double feedback = std::clamp(static_cast<double>(tailParameters.feedback), 0.0, 1.0);
+
+        if (feedback >= 1.0)
+            return std::numeric_limits<double>::infinity();
+
+        // The feedback matrices are orthogonal, so each pass scales the loop by the feedback
+        double repeats = feedback > 0 ? std::ceil(-3.0 / std::log10(feedback)) : 0.0;
+        return getLongestLoopSeconds(tailParameters) * (repeats + 1) + getDrainSeconds(tailParameters);
+    }
+
+    // Latency of the whole output in host samples, to be reported to the host
+    int getLatencySamples() const
+    {
+        return isVocoderActive() ? phaseVocoders[0].getLatencySamples() * rateConverter.getFactor() : 0;
+    }
+
+    // Adds the wet signal to the two channels in place, for the default roles
+    void process(SampleType* leftChannel, SampleType* rightChannel, int numSamples)
+    {
+        SampleType* channels[2] = { leftChannel, rightChannel };
+        process(channels, 2, numSamples);
+    }
+
+    // Adds the wet signal to every channel in place, see setChannelRoles().
+    // The wet path is stereo whatever the bus, so each extra channel costs
+    // only its share of the fold-down and the mix.
+    void process(SampleType* const* channels, int numChannels, int numSamples)
+    {
+        updateLines();
+
+        auto& kernels = DspKernels::get<SampleType>();
+        bool useVocoder = isVocoderActive();
+        numChannels = std::min(numChannels, MAX_CHANNELS);
+
+        for (int start = 0; start < numSamples;)
+        {
+            int chunkSize = std::min(numSamples - start, rateConverter.getMaximumBlockSize());
+
+            SampleType inputPeak = 0;
+            for (int channel = 0; channel < numChannels; ++channel)
+                inputPeak = std::max(inputPeak, getPeak(channels[channel] + start, chunkSize));
+
+            bool inputIsSilent = inputPeak < SILENCE_THRESHOLD;
+
+            // Once the input, every line and the later stages have stayed silent
+            // for a whole loop plus the drain time, nothing audible is left: the
+            // wet path is skipped and the channels keep their silent dry signal.
+            // The sleeping chunks clear the wet path a step at a time, so a longer
+            // delay or more lines after waking can't reach back into audio from
+            // before the silence
+            if (inputIsSilent && (isAsleep || quietSamples >= sleepAfterSamples))
+            {
+                if (! isAsleep)
+                {
+                    isAsleep = true;
+                    sleepClearStep = 0;
+                }
+
+                if (sleepClearStep < NUM_SLEEP_CLEAR_STEPS)
+                    clearSleepStep(sleepClearStep++);
+
+                start += chunkSize;
+                continue;
+            }
+
+            // Waking before the clear is done finishes it at once
+            while (sleepClearStep < NUM_SLEEP_CLEAR_STEPS)
+                clearSleepStep(sleepClearStep++);
+
+            isAsleep = false;
+
+            loopPeak = 0;
+            const SampleType* left = wetInputLeft.data();
+            const SampleType* right = wetInputRight.data();
+
+            if (isPlainStereo && numChannels == 2)
+            {
+                left = channels[0] + start;
+                right = channels[1] + start;
+            }
+            else if (isPlainMono && numChannels == 1)
+            {
+                left = right = channels[0] + start;
+            }
+            else
+            {
+                std::fill(wetInputLeft.begin(), wetInputLeft.begin() + chunkSize, SampleType(0));
+                std::fill(wetInputRight.begin(), wetInputRight.begin() + chunkSize, SampleType(0));
+
+                for (int channel = 0; channel < numChannels; ++channel)
+                {
+                    if (sendGainsLeft[static_cast<size_t>(channel)] != SampleType(0))
+                        kernels.addWithMultiply(wetInputLeft.data(), channels[channel] + start,
+                                                sendGainsLeft[static_cast<size_t>(channel)], chunkSize);
+
+                    if (sendGainsRight[static_cast<size_t>(channel)] != SampleType(0))
+                        kernels.addWithMultiply(wetInputRight.data(), channels[channel] + start,
+                                                sendGainsRight[static_cast<size_t>(channel)], chunkSize);
+                }
+            }
+
+            if (rateConverter.getFactor() == 1)
+            {
+                renderWet(left, right, wetOutputLeft.data(), wetOutputRight.data(), chunkSize);
+            }
+            else
+            {
+                rateConverter.process(left, right, wetOutputLeft.data(), wetOutputRight.data(), chunkSize,
+                                      [this](const SampleType* inLeft, const SampleType* inRight,
+                                             SampleType* outLeft, SampleType* outRight, int numWetSamples)
+                                      {
+                                          renderWet(inLeft, inRight, outLeft, outRight, numWetSamples);
+                                      });
+            }
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                SampleType* data = channels[channel] + start;
+
+                if (useVocoder)
+                {
+                    auto& compensation = dryCompensation[static_cast<size_t>(channel)];
+                    for (int sample = 0; sample < chunkSize; ++sample)
+                        data[sample] = compensation.processSample(data[sample]);
+                }
+
+                SampleType returnLeft = parameters.mix * returnGainsLeft[static_cast<size_t>(channel)];
+                SampleType returnRight = parameters.mix * returnGainsRight[static_cast<size_t>(channel)];
+
+                if (returnLeft != SampleType(0))
+                    kernels.addWithMultiply(data, wetOutputLeft.data(), returnLeft, chunkSize);
+
+                if (returnRight != SampleType(0))
+                    kernels.addWithMultiply(data, wetOutputRight.data(), returnRight, chunkSize);
+            }
+
+            if (inputIsSilent && loopPeak < SILENCE_THRESHOLD)
+                quietSamples = std::min(quietSamples + chunkSize, sleepAfterSamples);
+            else
+                quietSamples = 0;
+
+            start += chunkSize;
+        }
+    }
+
+private:
+    static constexpr SampleType SILENCE_THRESHOLD = SampleType(1.0e-5); // -100 dBFS
+
+    static SampleType getPeak(const SampleType* data, int numSamples)
+    {
+        SampleType peak = 0;
+        for (int i = 0; i < numSamples; ++i)
+            peak = std::max(peak, std::abs(data[i]));
+
+        return peak;
+    }
+
+    // Longest time a sample can spend in a line before it is read back
+    static double getLongestLoopSeconds(const Parameters& loopParameters)
+    {
+        // Spread is below one, so line 0 is the longest; the LFO adds up to its maximum offset
+        return static_cast<double>(loopParameters.delayTime)
+             + static_cast<double>(LFOManager<SampleType>::getMaximumOffsetSeconds(loopParameters.depth));
+    }
+
+    // Time for whatever has left the lines to get through the later stages
+    double getDrainSeconds(const Parameters& drainParameters) const
+    {
+        double seconds = static_cast<double>(pitchShifterManagers[0].getWindowSeconds());
+
+        if (drainParameters.pitchMode == PitchMode::PhaseVocoder)
+            seconds += phaseVocoders[0].getLatencySamples() * rateConverter.getFactor() / hostSampleRate;
+
+        if (drainParameters.diffusion > 0)
+            seconds += diffusionManager.getTailSeconds();
+
+        if (drainParameters.damp > 0)
+            seconds += static_cast<double>(dampManager.getTailSeconds(drainParameters.dampMode));
+
+        return seconds;
+    }
+
+    int getWetRateFactor() const
+    {
+        return parameters.wetRate >= 4 ? 4 : (parameters.wetRate >= 2 ? 2 : 1);
+    }
+
+    // Runs the whole wet path at the wet rate: input in, wet signal out
+    void renderWet(const SampleType* inLeft, const SampleType* inRight,
+                   SampleType* outLeft, SampleType* outRight, int numSamples)
+    {
+        auto& kernels = DspKernels::get<SampleType>();
+        bool shimmer = activePitchRouting == PitchRouting::Shimmer;
+        bool useVocoder = isVocoderActive();
+
+        for (int start = 0; start < numSamples;)
+        {
+            int fullDelayLines = static_cast<int>(std::floor(smoothedDelayLines.getCurrentValue()));
+
+            // Sub-blocks never exceed the shortest active delay, so every line can be
+            // read for the whole sub-block before any of its feedback is written
+            int blockSize = std::min(DspKernels::MAX_BLOCK_SIZE, numSamples - start);
+            for (int i = 0; i < fullDelayLines; ++i)
+                blockSize = std::min({ blockSize, delayManagersLeft[i].getMaximumBlockSize(),
+                                       delayManagersRight[i].getMaximumBlockSize() });
+
+            if (smoothedLinePan.isSmoothing())
+                updateLinePanGains(smoothedLinePan.skip(blockSize));
+
+            const SampleType* inputLeft = inLeft + start;
+            const SampleType* inputRight = inRight + start;
+
+            // While both channels have only ever carried the same input, every
+            // line and shifter holds the same state on both sides, so the left
+            // side is computed once and the right side copies it. Once split,
+            // the sides stay split until reset(), which also runs on going to
+            // sleep: proving two whole sets of line buffers equal again would
+            // cost more than the linked path saves
+            if (channelsLinked && ! kernels.isEqual(inputLeft, inputRight, blockSize))
+                channelsLinked = false;
+
+            bool linked = channelsLinked;
+
+            for (int i = 0; i < fullDelayLines; ++i)
+            {
+                delayManagersLeft[i].readBlock(lineOutputsLeft[i].data(), blockSize);
+                loopPeak = std::max(loopPeak, getPeak(lineOutputsLeft[i].data(), blockSize));
+
+                if (linked)
+                    std::copy(lineOutputsLeft[i].begin(), lineOutputsLeft[i].begin() + blockSize, lineOutputsRight[i].begin());
+                else
+                {
+                    delayManagersRight[i].readBlock(lineOutputsRight[i].data(), blockSize);
+                    loopPeak = std::max(loopPeak, getPeak(lineOutputsRight[i].data(), blockSize));
+                }
+
+                // Sub-blocks are no longer than the shortest delay, so shifting the
+                // whole block before it is fed back keeps the loop causal
+                if (shimmer && lineShiftGroups[i] >= 0 && static_cast<SampleType>(i) < parameters.octaves)
+                {
+                    if (linked)
+                        shimmerShifters[i].processBlockLinked(lineOutputsLeft[i].data(), lineOutputsRight[i].data(), blockSize);
+                    else
+                        shimmerShifters[i].processBlock(lineOutputsLeft[i].data(), lineOutputsRight[i].data(), blockSize);
+                }
+
+                std::copy(lineOutputsLeft[i].begin(), lineOutputsLeft[i].begin() + blockSize, lineFeedbackLeft[i].begin());
+                feedbackRowsLeft[i] = lineFeedbackLeft[i].data();
+
+                if (! linked)
+                {
+                    std::copy(lineOutputsRight[i].begin(), lineOutputsRight[i].begin() + blockSize, lineFeedbackRight[i].begin());
+                    feedbackRowsRight[i] = lineFeedbackRight[i].data();
+                }
+            }
+
+            // A linked right line mirrors the left one's writes, so its feedback is never needed
+            if (linked)
+            {
+                feedbackMatrix.processLinked(feedbackRowsLeft.data(), fullDelayLines, blockSize);
+                feedbackFilter.processLinked(feedbackRowsLeft.data(), fullDelayLines, blockSize);
+                feedbackSaturation.processLinked(feedbackRowsLeft.data(), fullDelayLines, blockSize);
+            }
+            else
+            {
+                feedbackMatrix.process(feedbackRowsLeft.data(), feedbackRowsRight.data(), fullDelayLines, blockSize);
+                feedbackFilter.process(feedbackRowsLeft.data(), feedbackRowsRight.data(), fullDelayLines, blockSize);
+                feedbackSaturation.process(feedbackRowsLeft.data(), feedbackRowsRight.data(), fullDelayLines, blockSize);
+            }
+
+            for (int i = 0; i < fullDelayLines; ++i)
+            {
+                delayManagersLeft[i].writeBlock(inputLeft, lineFeedbackLeft[i].data(), blockSize);
+
+                if (linked)
+                    delayManagersRight[i].mirrorBlock(delayManagersLeft[i], blockSize);
+                else
+                    delayManagersRight[i].writeBlock(inputRight, lineFeedbackRight[i].data(), blockSize);
+            }
+
+            // Inactive lines stay in warm standby: written but never read
+            for (int i = fullDelayLines; i < MaxLines; ++i)
+            {
+                delayManagersLeft[i].processStandbyBlock(inputLeft, blockSize);
+                delayManagersRight[i].processStandbyBlock(inputRight, blockSize);
+            }
+
+            std::fill(wetLeft.begin(), wetLeft.begin() + blockSize, SampleType(0));
+            std::fill(wetRight.begin(), wetRight.begin() + blockSize, SampleType(0));
+
+            for (int group = 0; group < numShiftGroups; ++group)
+            {
+                std::fill(shiftGroupsLeft[group].begin(), shiftGroupsLeft[group].begin() + blockSize, SampleType(0));
+                std::fill(shiftGroupsRight[group].begin(), shiftGroupsRight[group].begin() + blockSize, SampleType(0));
+            }
+
+            // Unshifted lines go straight to the wet bus, the rest to their group.
+            // Shimmer lines were already shifted inside the loop.
+            for (int i = 0; i < fullDelayLines; ++i)
+            {
+                int group = ! shimmer && static_cast<SampleType>(i) < parameters.octaves ? lineShiftGroups[i] : -1;
+                SampleType* destLeft = group < 0 ? wetLeft.data() : shiftGroupsLeft[group].data();
+                SampleType* destRight = group < 0 ? wetRight.data() : shiftGroupsRight[group].data();
+
+                // Each line's row of the lines x 2 pan matrix is applied as it is summed
+                kernels.addWithMultiply(destLeft, lineOutputsLeft[i].data(), linePanGainsLeft[i], blockSize);
+                kernels.addWithMultiply(destRight, lineOutputsRight[i].data(), linePanGainsRight[i], blockSize);
+            }
+
+            if (useVocoder)
+            {
+                for (int sample = 0; sample < blockSize; ++sample)
+                {
+                    wetLeft[sample] = wetCompensationLeft.processSample(wetLeft[sample]);
+                    wetRight[sample] = wetCompensationRight.processSample(wetRight[sample]);
+                }
+            }
+
+            // Groups keep running when empty so their buffers drain cleanly
+            for (int group = 0; group < (shimmer ? 0 : numShiftGroups); ++group)
+            {
+                // The vocoder already transforms both channels together
+                if (useVocoder)
+                    phaseVocoders[group].processBlock(shiftGroupsLeft[group].data(), shiftGroupsRight[group].data(), blockSize);
+                else if (linked)
+                    pitchShifterManagers[group].processBlockLinked(shiftGroupsLeft[group].data(), shiftGroupsRight[group].data(), blockSize);
+                else
+                    pitchShifterManagers[group].processBlock(shiftGroupsLeft[group].data(), shiftGroupsRight[group].data(), blockSize);
+
+                kernels.addWithMultiply(wetLeft.data(), shiftGroupsLeft[group].data(), SampleType(1), blockSize);
+                kernels.addWithMultiply(wetRight.data(), shiftGroupsRight[group].data(), SampleType(1), blockSize);
+            }
+
+            for (int sample = 0; sample < blockSize; ++sample)
+            {
+                // Scale the wet signal by the current (smoothed) number of delay lines
+                SampleType currentDelayLines = smoothedDelayLines.getNextValue();
+                wetLeft[sample] /= currentDelayLines;
+                wetRight[sample] /= currentDelayLines;
+            }
+
+            diffusionManager.processBlock(wetLeft.data(), wetRight.data(), blockSize);
+            dampManager.processBlock(wetLeft.data(), wetRight.data(), blockSize);
+
+            // Diffusion, echoes and the damp modes ring on after the lines fall silent
+            loopPeak = std::max({ loopPeak, getPeak(wetLeft.data(), blockSize), getPeak(wetRight.data(), blockSize) });
+
+            outputFilter.processBlock(wetLeft.data(), wetRight.data(), blockSize);
+
+            std::copy(wetLeft.begin(), wetLeft.begin() + blockSize, outLeft + start);
+            std::copy(wetRight.begin(), wetRight.begin() + blockSize, outRight + start);
+
+            start += blockSize;
+        }
+    }
+
+    // The vocoder only runs on the post path; inside the loop its latency
+    // would move every repeat, so shimmer always uses the time-domain shifter
+    bool isVocoderActive() const
+    {
+        return activePitchMode == PitchMode::PhaseVocoder && activePitchRouting == PitchRouting::Post;
+    }
+
+    // One bounded piece of clearing the wet path for sleep: a pair of lines
+    // per step, then the pitch paths, the damp stage and the small filters
+    void clearSleepStep(int step)
+    {
+        if (step < MaxLines)
+        {
+            delayManagersLeft[step].reset();
+            delayManagersRight[step].reset();
+        }
+        else if (step == MaxLines)
+        {
+            updateLatencyCompensation();
+            channelsLinked = true;
+        }
+        else if (step == MaxLines + 1)
+        {
+            dampManager.reset();
+        }
+        else
+        {
+            diffusionManager.reset();
+            feedbackFilter.reset();
+            feedbackSaturation.reset();
+            outputFilter.reset();
+            rateConverter.reset();
+        }
+    }
+
+    // Switching modes changes the output latency, so start every path clean
+    void updateLatencyCompensation()
+    {
+        for (auto& phaseVocoder : phaseVocoders)
+            phaseVocoder.reset();
+
+        for (auto& pitchShifter : pitchShifterManagers)
+            pitchShifter.reset();
+
+        for (auto& shimmerShifter : shimmerShifters)
+            shimmerShifter.reset();
+
+        int wetLatency = isVocoderActive() ? phaseVocoders[0].getLatencySamples() : 0;
+
+        for (auto& compensation : dryCompensation)
+        {
+            compensation.reset();
+            compensation.setDelay(getLatencySamples());
+        }
+
+        for (auto* compensation : { &wetCompensationLeft, &wetCompensationRight })
+        {
+            compensation->reset();
+            compensation->setDelay(wetLatency);
+        }
+    }
+
+    // Line 0 stays in the centre; the others alternate left and right,
+    // reaching the edges on the last pair of the numLines active lines.
+    // Lines still fading out past that stay at the edges
+    static constexpr SampleType getLinePosition(int line, int numLines)
+    {
+        SampleType distance = static_cast<SampleType>((line + 1) / 2) / static_cast<SampleType>(std::max(1, numLines / 2));
+        distance = std::min(distance, SampleType(1));
+        return line % 2 == 1 ? -distance : distance;
+    }
+
+    // Equal-power gains scaled so that a centred line passes at unity
+    void updateLinePanGains(SampleType width)
+    {
+        constexpr SampleType centreGain = SampleType(1.4142135623730951);
+
+        for (int i = 0; i < MaxLines; ++i)
+        {
+            linePanners[i].setPosition(width * getLinePosition(i, panLineCount));
+            linePanGainsLeft[i] = centreGain * linePanners[i].getLeftGain();
+            linePanGainsRight[i] = centreGain * linePanners[i].getRightGain();
+        }
+    }
+
+    // Applies the parameters to every line, once per process() call
+    void updateLines()
+    {
+        feedbackMatrix.setType(parameters.feedbackMatrix);
+        feedbackFilter.setLowPassFrequency(parameters.loopLowPassFreq);
+        feedbackFilter.setHighPassFrequency(parameters.loopHighPassFreq);
+        feedbackFilter.setCutoffSpread(parameters.loopFilterSpread);
+        feedbackSaturation.setDrive(parameters.drive);
+
+        if (parameters.pitchMode != activePitchMode || parameters.pitchRouting != activePitchRouting)
+        {
+            activePitchMode = parameters.pitchMode;
+            activePitchRouting = parameters.pitchRouting;
+            updateLatencyCompensation();
+        }
+
+        diffusionManager.setAmount(parameters.diffusion);
+        dampManager.setMode(parameters.dampMode);
+        dampManager.setDamp(parameters.damp);
+
+        outputFilter.setLowPassFrequency(parameters.lowPassFreq);
+        outputFilter.setHighPassFrequency(parameters.highPassFreq);
+        outputFilter.setSlope(static_cast<SampleType>(parameters.filterSlope));
+
+        smoothedLinePan.setTargetValue(std::clamp(parameters.linePan, SampleType(0), SampleType(1)));
+
+        sleepAfterSamples = static_cast<int>(std::ceil((getLongestLoopSeconds(parameters) + getDrainSeconds(parameters))
+                                                       * hostSampleRate));
+
+        int targetDelayLines = std::clamp(parameters.delayLines, 1, MaxLines);
+        smoothedDelayLines.setTargetValue(static_cast<SampleType>(targetDelayLines));
+
+        if (targetDelayLines != panLineCount)
+        {
+            panLineCount = targetDelayLines;
+            updateLinePanGains(smoothedLinePan.getCurrentValue());
+        }
+
+        for (int i = 0; i < MaxLines; ++i)
+        {
+            lfoManagersLeft[i].calculateAndSetRate(i);
+            lfoManagersRight[i].calculateAndSetRate(i);
+
+            lfoManagersLeft[i].setDepth(parameters.depth);
+            lfoManagersRight[i].setDepth(parameters.depth);
+
+            // Crossfade holds a fixed read head, so it is not modulated: a target
+            // that moved with the LFO every block would restart the fade each time
+            SampleType lfoValueLeft = 0;
+            SampleType lfoValueRight = 0;
+
+            if (parameters.delayMode == DelayTimeMode::Glide)
+            {
+                lfoValueLeft = lfoManagersLeft[i].getNextSample();
+                lfoValueRight = lfoManagersRight[i].getNextSample();
+            }
+
+            // Diverging modulation would pull the two sides apart
+            if (lfoValueLeft != lfoValueRight)
+                channelsLinked = false;
+            SampleType baseDelayTime = parameters.delayTime * std::pow(parameters.spread, static_cast<SampleType>(i));
+
+            delayManagersLeft[i].setDelayTime(baseDelayTime + lfoValueLeft);
+            delayManagersRight[i].setDelayTime(baseDelayTime + lfoValueRight);
+            delayManagersLeft[i].setFeedback(parameters.feedback);
+            delayManagersRight[i].setFeedback(parameters.feedback);
+            delayManagersLeft[i].setDelayTimeMode(parameters.delayMode);
+            delayManagersRight[i].setDelayTimeMode(parameters.delayMode);
+        }
+    }
+
+    Parameters parameters;
+
+    std::array<DelayManager<SampleType>, MaxLines> delayManagersLeft;
+    std::array<DelayManager<SampleType>, MaxLines> delayManagersRight;
+    std::array<LFOManager<SampleType>, MaxLines> lfoManagersLeft;
+    std::array<LFOManager<SampleType>, MaxLines> lfoManagersRight;
+
+    // One shifter per distinct non-unity factor, see setLineShiftFactors()
+    std::array<SampleType, MaxLines> lineShiftFactors {};
+    std::array<int, MaxLines> lineShiftGroups {};
+    std::array<SampleType, MaxLines> shiftGroupFactors {};
+    std::array<PitchShifterManager<SampleType>, MaxLines> pitchShifterManagers;
+    std::array<PhaseVocoderManager<SampleType>, MaxLines> phaseVocoders;
+    int numShiftGroups = 0;
+
+    // Shimmer needs every line's own shifted signal for its feedback
+    std::array<PitchShifterManager<SampleType>, MaxLines> shimmerShifters;
+
+    bool channelsLinked = true;
+
+    PitchMode activePitchMode = PitchMode::TimeDomain;
+    PitchRouting activePitchRouting = PitchRouting::Post;
+    std::array<FixedDelay<SampleType>, MAX_CHANNELS> dryCompensation;
+    FixedDelay<SampleType> wetCompensationLeft;
+    FixedDelay<SampleType> wetCompensationRight;
+
+    FeedbackMatrixManager<SampleType> feedbackMatrix;
+    FeedbackFilterManager<SampleType> feedbackFilter;
+    FeedbackSaturationManager<SampleType> feedbackSaturation;
+
+    // Per sub-block scratch, see DspKernels::MAX_BLOCK_SIZE
+    using LineBlock = std::array<SampleType, DspKernels::MAX_BLOCK_SIZE>;
+    std::array<LineBlock, MaxLines> lineOutputsLeft {};
+    std::array<LineBlock, MaxLines> lineOutputsRight {};
+    std::array<LineBlock, MaxLines> lineFeedbackLeft {};
+    std::array<LineBlock, MaxLines> lineFeedbackRight {};
+    std::array<SampleType*, MaxLines> feedbackRowsLeft {};
+    std::array<SampleType*, MaxLines> feedbackRowsRight {};
+    std::array<LineBlock, MaxLines> shiftGroupsLeft {};
+    std::array<LineBlock, MaxLines> shiftGroupsRight {};
+    LineBlock wetLeft {};
+    LineBlock wetRight {};
+
+    DiffusionManager<SampleType> diffusionManager;
+    DampManager<SampleType> dampManager;
+
+    FilterManager<SampleType> outputFilter;
+
+    LinearSmoothedValue<SampleType> smoothedDelayLines;
+
+    std::array<StereoFieldManager<SampleType>, MaxLines> linePanners;
+    std::array<SampleType, MaxLines> linePanGainsLeft {};
+    std::array<SampleType, MaxLines> linePanGainsRight {};
+    LinearSmoothedValue<SampleType> smoothedLinePan;
+    int panLineCount = MaxLines;    // Line count the pan pattern is spread over
+
+    RateConverterManager<SampleType> rateConverter;
+
+    // Wet input and output of one host chunk, see RateConverterManager::getMaximumBlockSize()
+    using HostChunk = std::array<SampleType, DspKernels::MAX_BLOCK_SIZE * RateConverterManager<SampleType>::MAX_FACTOR>;
+    HostChunk wetInputLeft {};
+    HostChunk wetInputRight {};
+    HostChunk wetOutputLeft {};
+    HostChunk wetOutputRight {};
+
+    std::array<SampleType, MAX_CHANNELS> sendGainsLeft {};
+    std::array<SampleType, MAX_CHANNELS> sendGainsRight {};
+    std::array<SampleType, MAX_CHANNELS> returnGainsLeft {};
+    std::array<SampleType, MAX_CHANNELS> returnGainsRight {};
+    bool isPlainStereo = true;
+    bool isPlainMono = false;
+
+    // Silence tracking, see process()
+    double hostSampleRate = 44100.0;
+    static constexpr int NUM_SLEEP_CLEAR_STEPS = MaxLines + 3;
+    SampleType loopPeak = 0;        // Loudest line or stage output in the current chunk
+    int quietSamples = 0;           // Host samples that input, lines and stages have been silent for
+    int sleepAfterSamples = 0;
+    bool isAsleep = false;
+    int sleepClearStep = NUM_SLEEP_CLEAR_STEPS;
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <array>
+#include "DspCommon.h"
+#include "DspKernels.h"
+
+// Runs part of the signal chain at a half or a quarter of the host rate.
+// Each octave down or up is a polyphase IIR half-band: two chains of
+// first-order allpasses, each running at the lower rate, so a stage costs
+// a handful of multiplies per low-rate sample.
+//
+// The low-rate output comes back factor - 1 samples plus the filter group
+// delay late. The chain runs here only on the wet signal, where that just
+// lengthens each echo by a fraction of a millisecond.
+template <typename SampleType>
+class RateConverterManager
+{
+public:
+    static constexpr int MAX_FACTOR = 4;
+
+    // factor is 1, 2 or 4
+    void prepare(int newFactor)
+    {
+        factor = newFactor >= 4 ? 4 : (newFactor >= 2 ? 2 : 1);
+        numStages = factor == 4 ? 2 : (factor == 2 ? 1 : 0);
+        reset();
+    }
+
+    void reset()
+    {
+        for (auto& stage : decimators)
+            for (auto& channel : stage)
+                channel = HalfBand();
+
+        for (auto& stage : interpolators)
+            for (auto& channel : stage)
+                channel = HalfBand();
+
+        for (auto& phase : decimatorPhases)
+            phase = 0;
+
+        // Primed so that every host block can be served in full, see process()
+        for (auto& fifo : outputFifos)
+            fifo.fill(0);
+
+        fifoReadPos = 0;
+        fifoWritePos = factor - 1;
+    }
+
+    int getFactor() const { return factor; }
+
+    // Longest host block process() takes
+    int getMaximumBlockSize() const { return DspKernels::MAX_BLOCK_SIZE * factor; }
+
+    // Decimates the input, calls render(inLeft, inRight, outLeft, outRight, numLowRateSamples)
+    // on what that yields, and interpolates its output back to the host rate
+    template <typename Render>
+    void process(const SampleType* inLeft, const SampleType* inRight, SampleType* outLeft, SampleType* outRight,
+                 int numSamples, Render&& render)
+    {
+        const SampleType* inputs[2] = { inLeft, inRight };
+        int produced = 0;
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            auto& data = lowRate[static_cast<size_t>(channel)];
+            std::copy(inputs[channel], inputs[channel] + numSamples, stageBuffer.begin());
+            int count = numSamples;
+
+            for (int stage = 0; stage < numStages; ++stage)
+                count = decimate(stage, channel, stageBuffer.data(), count);
+
+            std::copy(stageBuffer.begin(), stageBuffer.begin() + count, data.begin());
+            produced = count;
+        }
+
+        // Both channels are decimated in step, so they share the phase
+        for (int stage = 0; stage < numStages; ++stage)
+            decimatorPhases[static_cast<size_t>(stage)] = nextDecimatorPhases[static_cast<size_t>(stage)];
+
+        if (produced > 0)
+            render(lowRate[0].data(), lowRate[1].data(), lowRateOutput[0].data(), lowRateOutput[1].data(), produced);
+
+        for (int channel = 0; channel < 2; ++channel)
+        {
+            std::copy(lowRateOutput[static_cast<size_t>(channel)].begin(),
+                      lowRateOutput[static_cast<size_t>(channel)].begin() + produced, stageBuffer.begin());
+            int count = produced;
+
+            for (int stage = numStages - 1; stage >= 0; --stage)
+                count = interpolate(stage, channel, stageBuffer.data(), count);
+
+            auto& fifo = outputFifos[static_cast<size_t>(channel)];
+            for (int i = 0; i < count; ++i)
+                fifo[static_cast<size_t>((fifoWritePos + i) % FIFO_SIZE)] = stageBuffer[static_cast<size_t>(i)];
+        }
+
+        fifoWritePos = (fifoWritePos + produced * factor) % FIFO_SIZE;
+
+        // The fifo always holds at least numSamples here: it starts with factor - 1
+        // samples, which is exactly what the decimators can be holding back
+        SampleType* outputs[2] = { outLeft, outRight };
+        for (int channel = 0; channel < 2; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                outputs[channel][i] = outputFifos[static_cast<size_t>(channel)][static_cast<size_t>((fifoReadPos + i) % FIFO_SIZE)];
+
+        fifoReadPos = (fifoReadPos + numSamples) % FIFO_SIZE;
+    }
+
+private:
+    // 8 coefficients for a transition band of 0.05 of the higher rate:
+    // 106 dB stopband, flat passband up to 0.225 of the higher rate.
+    // Even entries form the direct path, odd entries the delayed one.
+    static constexpr int NUM_COEFFICIENTS = 8;
+    static constexpr int PATH_LENGTH = NUM_COEFFICIENTS / 2;
+    static constexpr std::array<double, NUM_COEFFICIENTS> COEFFICIENTS {
+        0.035832788431, 0.134090141943, 0.272040143396, 0.424324871272,
+        0.572057197236, 0.706292142139, 0.827124761997, 0.941503094174
+    };
+
+    static constexpr int MAX_STAGES = 2;
+    static constexpr int FIFO_SIZE = 2 * DspKernels::MAX_BLOCK_SIZE * MAX_FACTOR;
+
+    struct HalfBand
+    {
+        // previous[k] holds the previous input of section k, previous[PATH_LENGTH]
+        // the previous output of the last section
+        std::array<SampleType, PATH_LENGTH + 1> previousDirect {};
+        std::array<SampleType, PATH_LENGTH + 1> previousDelayed {};
+        SampleType pendingSample = 0;   // Decimator: even sample awaiting its pair
+        SampleType lastOdd = 0;         // Decimator: odd sample for the delayed path
+    };
+
+    // Each section is (a + z^-1) / (1 + a z^-1) at the lower rate
+    static SampleType processPath(std::array<SampleType, PATH_LENGTH + 1>& previous, SampleType input, int firstCoefficient)
+    {
+        for (int k = 0; k < PATH_LENGTH; ++k)
+        {
+            auto a = static_cast<SampleType>(COEFFICIENTS[static_cast<size_t>(firstCoefficient + 2 * k)]);
+            SampleType output = a * (input - previous[static_cast<size_t>(k + 1)]) + previous[static_cast<size_t>(k)];
+            previous[static_cast<size_t>(k)] = input;
+            input = output;
+        }
+
+        previous[PATH_LENGTH] = input;
+        return input;
+    }
+
+    // In place; returns the number of lower-rate samples written
+    int decimate(int stage, int channel, SampleType* data, int numSamples)
+    {
+        auto& filter = decimators[static_cast<size_t>(stage)][static_cast<size_t>(channel)];
+        int phase = decimatorPhases[static_cast<size_t>(stage)];
+        int count = 0;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            if (phase == 0)
+            {
+                filter.pendingSample = data[i];
+                phase = 1;
+                continue;
+            }
+
+            SampleType direct = processPath(filter.previousDirect, filter.pendingSample, 0);
+            SampleType delayed = processPath(filter.previousDelayed, filter.lastOdd, 1);
+            filter.lastOdd = data[i];
+            data[count++] = SampleType(0.5) * (direct + delayed);
+            phase = 0;
+        }
+
+        nextDecimatorPhases[static_cast<size_t>(stage)] = phase;
+        return count;
+    }
+
+    // In place; returns the number of higher-rate samples written
+    int interpolate(int stage, int channel, SampleType* data, int numSamples)
+    {
+        auto& filter = interpolators[static_cast<size_t>(stage)][static_cast<size_t>(channel)];
+
+        for (int i = 0; i < numSamples; ++i)
+            stageScratch[static_cast<size_t>(i)] = data[i];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            SampleType input = stageScratch[static_cast<size_t>(i)];
+            data[2 * i] = processPath(filter.previousDirect, input, 0);
+            data[2 * i + 1] = processPath(filter.previousDelayed, input, 1);
+        }
+
+        return 2 * numSamples;
+    }
+
+    int factor = 1;
+    int numStages = 0;
+
+    std::array<std::array<HalfBand, 2>, MAX_STAGES> decimators {};
+    std::array<std::array<HalfBand, 2>, MAX_STAGES> interpolators {};
+    std::array<int, MAX_STAGES> decimatorPhases {};
+    std::array<int, MAX_STAGES> nextDecimatorPhases {};
+
+    using HostBlock = std::array<SampleType, DspKernels::MAX_BLOCK_SIZE * MAX_FACTOR>;
+    HostBlock stageBuffer {};
+    HostBlock stageScratch {};
+    std::array<std::array<SampleType, DspKernels::MAX_BLOCK_SIZE + 1>, 2> lowRate {};
+    std::array<std::array<SampleType, DspKernels::MAX_BLOCK_SIZE + 1>, 2> lowRateOutput {};
+
+    std::array<std::array<SampleType, FIFO_SIZE>, 2> outputFifos {};
+    int fifoReadPos = 0;
+    int fifoWritePos = 0;
+};
@@ -1,35 +1,134 @@
 #pragma once
 
-#include <JuceHeader.h>
 #include <array>
 #include <random>
+#include "DspCommon.h"
 
+// Equal-power pan law as one table, built at compile time and shared by
+// every panner in the process. Entry i holds the left and right gains for
+// position -1 + 2 * i / (SIZE - 1).
+template <typename SampleType>
+struct PanningTable
+{
+    static constexpr int SIZE = 256;
+
+    using Gains = std::array<SampleType, 2>;
+
+    static constexpr Gains get(int index) { return table[static_cast<size_t>(index)]; }
+
+private:
+    // std::sin is not constexpr; the Taylor series to x^21 is exact to
+    // double precision on [0, pi/2]
+    static constexpr double sine(double x)
+    {
+        double term = x;
+        double sum = x;
+
+        for (int n = 1; n <= 10; ++n)
+        {
+            term *= -x * x / static_cast<double>((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    static constexpr std::array<Gains, SIZE> build()
+    {
+        std::array<Gains, SIZE> gains {};
+        constexpr double quarterPi = 0.25 * EngineConstants<double>::pi;
+
+        for (int i = 0; i < SIZE; ++i)
+        {
+            // Map the position to an angle between 0 and pi/2
+            double position = -1.0 + 2.0 * i / (SIZE - 1);
+            double angle = (position + 1.0) * quarterPi;
+
+            gains[static_cast<size_t>(i)] = { static_cast<SampleType>(sine(2.0 * quarterPi - angle)),
+                                              static_cast<SampleType>(sine(angle)) };
+        }
+
+        return gains;
+    }
+
+    static constexpr std::array<Gains, SIZE> table = build();
+};
+
+template <typename SampleType>
 class StereoFieldManager
 {
 public:
-    StereoFieldManager();
+    StereoFieldManager()
+    {
+        // Seed RNG with a unique value
+        std::random_device rd;
+        rng.seed(rd());
+    }
+
+    void prepare(const EngineSpec& spec)
+    {
+        sampleRate = static_cast<SampleType>(spec.sampleRate);
+        reset();
+        calculateGains();
+    }
+
+    void reset()
+    {
+        // No per-sample processing needed
+    }
+
+    void setPosition(SampleType newPosition)
+    {
+        currentPosition = std::clamp(newPosition, SampleType(-1), SampleType(1));
+        calculateGains();
+    }
 
-    void prepare(const juce::dsp::ProcessSpec& spec);
-    void reset();
-    void setPosition(float newPosition);
-    void calculateAndSetPosition(int delayIndex, int totalDelays);
+    void calculateAndSetPosition(int delayIndex, int totalDelays)
+    {
+        SampleType position = calculateStereoPosition(delayIndex, totalDelays);
+        setPosition(position);
+    }
 
-    float getLeftGain() const { return leftGain; }
-    float getRightGain() const { return rightGain; }
-    float getCurrentPosition() const { return currentPosition; }
+    SampleType getLeftGain() const { return leftGain; }
+    SampleType getRightGain() const { return rightGain; }
+    SampleType getCurrentPosition() const { return currentPosition; }
 
 private:
-    float calculateStereoPosition(int delayIndex, int totalDelays);
-    void calculateGains();
+    SampleType calculateStereoPosition(int delayIndex, int totalDelays)
+    {
+        if (totalDelays < 1)
+            totalDelays = 1;
+
+        SampleType centerIndex = static_cast<SampleType>(totalDelays - 1) * SampleType(0.5);
+        SampleType position = (static_cast<SampleType>(delayIndex) - centerIndex) / centerIndex; // Normalize to -1.0 to 1.0
+
+        // Reduce randomness
+        std::uniform_real_distribution<SampleType> positionJitter(SampleType(-0.02), SampleType(0.02));
+        SampleType randomValue = positionJitter(rng);
+
+        position += randomValue;
+
+        return std::clamp(position, SampleType(-1), SampleType(1));
+    }
+
+    void calculateGains()
+    {
+        // Map currentPosition to table index
+        // Interpolated, so that the centre lands exactly between two entries
+        SampleType tablePosition = ((currentPosition + SampleType(1)) * SampleType(0.5)) * (PanningTable<SampleType>::SIZE - 1);
+        int index = std::clamp(static_cast<int>(tablePosition), 0, PanningTable<SampleType>::SIZE - 2);
+        SampleType frac = tablePosition - static_cast<SampleType>(index);
 
-    static constexpr int PANNING_TABLE_SIZE = 256;
-    std::array<float, PANNING_TABLE_SIZE> leftPanningTable;
-    std::array<float, PANNING_TABLE_SIZE> rightPanningTable;
+        auto gains = PanningTable<SampleType>::get(index);
+        auto nextGains = PanningTable<SampleType>::get(index + 1);
+        leftGain = gains[0] + frac * (nextGains[0] - gains[0]);
+        rightGain = gains[1] + frac * (nextGains[1] - gains[1]);
+    }
 
-    float sampleRate;
-    float currentPosition = 0.0f;
-    float leftGain = 0.7071f;  // Default to center position
-    float rightGain = 0.7071f;
+    SampleType sampleRate = SampleType(44100);
+    SampleType currentPosition = 0;
+    SampleType leftGain = SampleType(0.7071);  // Default to center position
+    SampleType rightGain = SampleType(0.7071);
 
     std::mt19937 rng; // Random number generator
 };
@@ -0,0 +1,408 @@
+// Standalone checks for the JUCE-free engine: every vector kernel against
+// the scalar reference, the partitioned convolution against a direct one,
+// the FDN's decay, the latency each pitch mode reports against where the
+// audio really comes out, and what the engine remembers after sleeping.
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "QuantaEngine.h"
+
+namespace
+{
+    int numFailures = 0;
+
+    void expect(bool condition, const std::string& what)
+    {
+        if (! condition)
+        {
+            std::printf("FAILED: %s\n", what.c_str());
+            ++numFailures;
+        }
+    }
+
+    template <typename SampleType>
+    std::vector<SampleType> makeNoise(std::mt19937& rng, int numSamples)
+    {
+        std::uniform_real_distribution<SampleType> distribution(SampleType(-1), SampleType(1));
+        std::vector<SampleType> noise(static_cast<size_t>(numSamples));
+
+        for (auto& sample : noise)
+            sample = distribution(rng);
+
+        return noise;
+    }
+
+    template <typename SampleType>
+    double getMaxDifference(const std::vector<SampleType>& a, const std::vector<SampleType>& b)
+    {
+        double difference = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+            difference = std::max(difference, std::abs(static_cast<double>(a[i]) - static_cast<double>(b[i])));
+
+        return difference;
+    }
+
+    template <typename SampleType>
+    int getPeakIndex(const std::vector<SampleType>& data, int start, int end)
+    {
+        int peak = start;
+        for (int i = start; i < end; ++i)
+            if (std::abs(data[static_cast<size_t>(i)]) > std::abs(data[static_cast<size_t>(peak)]))
+                peak = i;
+
+        return peak;
+    }
+
+    //==============================================================================
+    DspKernels::SvfCoefficients<float> makeSvfCoefficients(double cutoff, double q, bool isHighPass)
+    {
+        DspKernels::SvfCoefficients<float> c;
+        double g = std::tan(EngineConstants<double>::pi * cutoff / 48000.0);
+        double r2 = 1.0 / q;
+
+        c.g = static_cast<float>(g);
+        c.r2 = static_cast<float>(r2);
+        c.h = static_cast<float>(1.0 / (1.0 + r2 * g + g * g));
+        c.lowPassMix = isHighPass ? 0.0f : 1.0f;
+        c.highPassMix = isHighPass ? 1.0f : 0.0f;
+        return c;
+    }
+
+    // Each kernel of the table runs on the same data as the scalar reference.
+    // The vector paths may fuse multiply-adds, so results only match closely.
+    void testKernelTable(const DspKernels::KernelTable<float>& table)
+    {
+        const auto& reference = DspKernels::getScalar<float>();
+        const std::string name = table.name;
+        std::mt19937 rng(1);
+
+        for (int numSamples : { 1, 3, 7, 16, 31, 64 })
+        {
+            const std::string size = " (" + std::to_string(numSamples) + " samples)";
+
+            auto input = makeNoise<float>(rng, numSamples);
+            auto feedback = makeNoise<float>(rng, numSamples);
+            auto gains = makeNoise<float>(rng, numSamples);
+
+            std::vector<float> expected(static_cast<size_t>(numSamples)), actual(static_cast<size_t>(numSamples));
+            reference.writeWithFeedback(expected.data(), input.data(), feedback.data(), gains.data(), numSamples);
+            table.writeWithFeedback(actual.data(), input.data(), feedback.data(), gains.data(), numSamples);
+            expect(getMaxDifference(expected, actual) < 1.0e-6, name + " writeWithFeedback" + size);
+
+            expected = actual = makeNoise<float>(rng, numSamples);
+            reference.addWithMultiply(expected.data(), input.data(), 0.7f, numSamples);
+            table.addWithMultiply(actual.data(), input.data(), 0.7f, numSamples);
+            expect(getMaxDifference(expected, actual) < 1.0e-6, name + " addWithMultiply" + size);
+
+            auto source = makeNoise<float>(rng, 256);
+            std::uniform_int_distribution<int> indexDistribution(0, 254);
+            std::vector<int> indices(static_cast<size_t>(numSamples));
+            for (auto& index : indices)
+                index = indexDistribution(rng);
+
+            std::vector<float> fractions(static_cast<size_t>(numSamples));
+            for (auto& fraction : fractions)
+                fraction = std::uniform_real_distribution<float>(0.0f, 1.0f)(rng);
+
+            reference.interpolateLinear(expected.data(), source.data(), indices.data(), fractions.data(), numSamples);
+            table.interpolateLinear(actual.data(), source.data(), indices.data(), fractions.data(), numSamples);
+            expect(getMaxDifference(expected, actual) < 1.0e-6, name + " interpolateLinear" + size);
+
+            auto delayed = makeNoise<float>(rng, numSamples);
+            std::vector<float> expectedState(static_cast<size_t>(numSamples)), actualState(static_cast<size_t>(numSamples));
+            expected = actual = input;
+            reference.processAllpass(expected.data(), delayed.data(), expectedState.data(), 0.6f, numSamples);
+            table.processAllpass(actual.data(), delayed.data(), actualState.data(), 0.6f, numSamples);
+            expect(getMaxDifference(expected, actual) < 1.0e-6 && getMaxDifference(expectedState, actualState) < 1.0e-6,
+                   name + " processAllpass" + size);
+
+            actual = input;
+            expect(table.isEqual(input.data(), actual.data(), numSamples), name + " isEqual on equal blocks" + size);
+
+            for (int changed : { 0, numSamples / 2, numSamples - 1 })
+            {
+                actual = input;
+                actual[static_cast<size_t>(changed)] += 1.0f;
+                expect(! table.isEqual(input.data(), actual.data(), numSamples),
+                       name + " isEqual with sample " + std::to_string(changed) + " changed" + size);
+            }
+        }
+
+        // A cascade that ramps for a few blocks and then holds, so the state
+        // carried from block to block is checked too
+        constexpr int numStages = 4;
+        DspKernels::SvfState<float> expectedStates[numStages], actualStates[numStages];
+        DspKernels::SvfCoefficients<float> from[numStages], to[numStages];
+
+        for (int stage = 0; stage < numStages; ++stage)
+            from[stage] = to[stage] = makeSvfCoefficients(300.0 * (stage + 1), 0.707, stage % 2 == 1);
+
+        double svfDifference = 0;
+
+        for (int block = 0; block < 16; ++block)
+        {
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                from[stage] = to[stage];
+                if (block < 8)
+                    to[stage] = makeSvfCoefficients(300.0 * (stage + 1) * std::pow(1.25, block + 1), 0.5 + 0.1 * block, stage % 2 == 1);
+            }
+
+            auto left = makeNoise<float>(rng, 48);
+            auto right = makeNoise<float>(rng, 48);
+            auto expectedLeft = left, expectedRight = right;
+
+            reference.processSvfStereo(expectedStates, from, to, numStages, expectedLeft.data(), expectedRight.data(), 48);
+            table.processSvfStereo(actualStates, from, to, numStages, left.data(), right.data(), 48);
+
+            svfDifference = std::max({ svfDifference, getMaxDifference(expectedLeft, left), getMaxDifference(expectedRight, right) });
+        }
+
+        expect(svfDifference < 1.0e-4, name + " processSvfStereo, off by " + std::to_string(svfDifference));
+    }
+
+    void testKernels()
+    {
+        using DspKernels::InstructionSet;
+
+        for (auto instructionSet : { InstructionSet::SSE2, InstructionSet::AVX2, InstructionSet::AVX512 })
+        {
+            if (auto* table = DspKernels::getForInstructionSet<float>(instructionSet))
+                testKernelTable(*table);
+            else
+                std::printf("Skipped instruction set %d: not supported here\n", static_cast<int>(instructionSet));
+        }
+    }
+
+    //==============================================================================
+    // Odd block sizes and a response that is not a whole number of partitions,
+    // against the textbook sum, one partition late
+    void testConvolution()
+    {
+        constexpr int partitionSize = 64;
+        constexpr int impulseLength = 1000;
+        constexpr int numSamples = 4096;
+
+        std::mt19937 rng(2);
+        auto impulseLeft = makeNoise<double>(rng, impulseLength);
+        auto impulseRight = makeNoise<double>(rng, impulseLength);
+
+        ConvolutionManager<double> convolution;
+        convolution.prepare(partitionSize, impulseLength);
+        convolution.loadImpulseResponse(impulseLeft.data(), impulseRight.data(), impulseLength);
+
+        // One silent partition takes over the response and finishes its fade-in
+        std::vector<double> silence(partitionSize), ignoredLeft(partitionSize), ignoredRight(partitionSize);
+        convolution.processBlock(silence.data(), ignoredLeft.data(), ignoredRight.data(), partitionSize);
+
+        auto input = makeNoise<double>(rng, numSamples);
+        std::vector<double> left(numSamples), right(numSamples);
+
+        for (int start = 0; start < numSamples; start += 37)
+        {
+            int blockSize = std::min(37, numSamples - start);
+            convolution.processBlock(input.data() + start, left.data() + start, right.data() + start, blockSize);
+        }
+
+        int latency = convolution.getLatencySamples();
+        expect(latency == partitionSize, "Convolution reports one partition of latency");
+
+        std::vector<double> expectedLeft(numSamples), expectedRight(numSamples);
+
+        for (int n = latency; n < numSamples; ++n)
+        {
+            for (int j = 0; j < impulseLength && j <= n - latency; ++j)
+            {
+                expectedLeft[static_cast<size_t>(n)] += impulseLeft[static_cast<size_t>(j)] * input[static_cast<size_t>(n - latency - j)];
+                expectedRight[static_cast<size_t>(n)] += impulseRight[static_cast<size_t>(j)] * input[static_cast<size_t>(n - latency - j)];
+            }
+        }
+
+        expect(getMaxDifference(expectedLeft, left) < 1.0e-9 && getMaxDifference(expectedRight, right) < 1.0e-9,
+               "Convolution matches direct convolution");
+    }
+
+    //==============================================================================
+    // The network has no input gain to speak of, so only the shape is checked:
+    // it answers, stays finite and loses about 60 dB over its decay time
+    void testFdnDecay()
+    {
+        constexpr double sampleRate = 48000.0;
+        constexpr double decayTime = 1.0;
+
+        for (int numLines : { 8, 16 })
+        {
+            FdnManager<double> fdn;
+            EngineSpec spec;
+            spec.sampleRate = sampleRate;
+            fdn.prepare(spec);
+            fdn.setNumLines(numLines);
+            fdn.setDecayTime(decayTime);
+            fdn.setDampingFrequency(20000.0);
+            fdn.reset();
+
+            auto windowLength = static_cast<int>(0.1 * sampleRate);
+            auto length = static_cast<int>((decayTime + 0.3) * sampleRate);
+            double earlyEnergy = 0, lateEnergy = 0;
+            bool isFinite = true;
+
+            for (int n = 0; n < length; ++n)
+            {
+                double input = n == 0 ? 1.0 : 0.0;
+                double left = 0, right = 0;
+                fdn.processSample(input, input, left, right);
+
+                isFinite = isFinite && std::isfinite(left) && std::isfinite(right);
+                double energy = left * left + right * right;
+
+                if (n >= windowLength && n < 2 * windowLength)
+                    earlyEnergy += energy;
+                else if (n >= windowLength + static_cast<int>(decayTime * sampleRate) && n < 2 * windowLength + static_cast<int>(decayTime * sampleRate))
+                    lateEnergy += energy;
+            }
+
+            double decayDb = 10.0 * std::log10(lateEnergy / earlyEnergy);
+            const std::string name = "FDN with " + std::to_string(numLines) + " lines";
+
+            expect(isFinite && earlyEnergy > 0, name + " answers an impulse");
+            expect(decayDb < -50.0 && decayDb > -70.0, name + " decays about 60 dB over its decay time, got " + std::to_string(decayDb));
+        }
+    }
+
+    //==============================================================================
+    // The dry signal must come out exactly getLatencySamples() late, and the
+    // first echo of an unshifted line one delay time after that. At a lower
+    // wet rate the echo may come a little later still: the rate converter's
+    // group delay lengthens the echo, it is not latency (see RateConverterManager)
+    void testReportedLatency()
+    {
+        using Engine = QuantaEngine<float, 10>;
+        constexpr double sampleRate = 48000.0;
+        constexpr float delayTime = 0.1f;
+
+        std::array<float, 10> unityFactors;
+        unityFactors.fill(1.0f);
+
+        for (auto pitchMode : { Engine::PitchMode::TimeDomain, Engine::PitchMode::PhaseVocoder })
+        {
+            for (int wetRate : { 1, 2, 4 })
+            {
+                auto engine = std::make_unique<Engine>();
+                Engine::Parameters parameters;
+                parameters.mix = 1;
+                parameters.delayTime = delayTime;
+                parameters.feedback = 0;
+                parameters.depth = 0;
+                parameters.pitchMode = pitchMode;
+                parameters.wetRate = wetRate;
+
+                engine->setLineShiftFactors(unityFactors);
+                engine->setParameters(parameters);
+
+                EngineSpec spec;
+                spec.sampleRate = sampleRate;
+                engine->prepare(spec);
+
+                const std::string name = std::string(pitchMode == Engine::PitchMode::PhaseVocoder ? "Phase vocoder" : "Time domain")
+                                       + " at 1/" + std::to_string(wetRate) + " rate";
+
+                int latency = engine->getLatencySamples();
+                int expectedLatency = pitchMode == Engine::PitchMode::PhaseVocoder ? 1536 * wetRate : 0;
+                expect(latency == expectedLatency, name + " reports " + std::to_string(latency) + " samples of latency");
+
+                std::vector<float> left(static_cast<size_t>(sampleRate * 0.5)), right(left.size());
+                left[0] = right[0] = 1.0f;
+
+                for (int start = 0; start < static_cast<int>(left.size()); start += 512)
+                {
+                    int blockSize = std::min(512, static_cast<int>(left.size()) - start);
+                    engine->process(left.data() + start, right.data() + start, blockSize);
+                }
+
+                int dryPosition = getPeakIndex(left, 0, latency + 64);
+                expect(dryPosition == latency, name + " delays the dry signal by its latency");
+
+                int delaySamples = static_cast<int>(std::lround(delayTime * sampleRate));
+                int echoPosition = getPeakIndex(left, latency + 64, static_cast<int>(left.size()));
+                int echoLag = echoPosition - (latency + delaySamples);
+                expect(echoLag >= 0 && echoLag <= 8 * wetRate,
+                       name + " puts the first echo " + std::to_string(echoLag) + " samples after the delay time");
+            }
+        }
+    }
+
+    //==============================================================================
+    // After going to sleep, a longer delay and more lines must not reach back
+    // into the audio from before the silence
+    void testSleepForgetsOldAudio()
+    {
+        using Engine = QuantaEngine<float, 10>;
+
+        auto engine = std::make_unique<Engine>();
+        Engine::Parameters parameters;
+        parameters.delayLines = 4;
+        parameters.delayTime = 0.05f;
+        parameters.feedback = 0.2f;
+        parameters.octaves = 0;
+        engine->setParameters(parameters);
+
+        EngineSpec spec;
+        spec.sampleRate = 48000.0;
+        engine->prepare(spec);
+
+        std::mt19937 rng(3);
+        std::vector<float> left(512), right(512);
+
+        auto run = [&](int numBlocks, float level)
+        {
+            float peak = 0;
+
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                left = makeNoise<float>(rng, 512);
+                for (auto& sample : left)
+                    sample *= level;
+
+                right = left;
+                engine->process(left.data(), right.data(), 512);
+
+                for (float sample : left)
+                    peak = std::max(peak, std::abs(sample));
+            }
+
+            return peak;
+        };
+
+        run(50, 0.5f);
+        run(200, 0.0f);
+        expect(run(200, 0.0f) == 0.0f, "The engine falls silent once the tails have gone");
+
+        parameters.delayTime = 1.5f;
+        parameters.delayLines = 10;
+        engine->setParameters(parameters);
+
+        expect(run(300, 1.0e-4f) < 1.0e-3f, "Waking with longer delays replays nothing from before the silence");
+    }
+}
+
+int main()
+{
+    testKernels();
+    testConvolution();
+    testFdnDecay();
+    testReportedLatency();
+    testSleepForgetsOldAudio();
+
+    if (numFailures > 0)
+    {
+        std::printf("%d check(s) failed\n", numFailures);
+        return 1;
+    }
+
+    std::printf("All checks passed\n");
+    return 0;
+}